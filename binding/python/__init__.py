@@ -11,4 +11,6 @@
 
 from ._factory import *
 from ._koala import *
+from ._process_pool import *
+from ._stream import *
 from ._util import *
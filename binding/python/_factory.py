@@ -9,7 +9,10 @@
 # specific language governing permissions and limitations under the License.
 #
 
-from typing import Optional
+import atexit
+import contextlib
+import threading
+from typing import Dict, Iterator, List, Optional, Tuple
 
 from ._koala import Koala
 from ._util import default_library_path, default_model_path
@@ -40,4 +43,71 @@ def create(
         library_path=library_path)
 
 
-__all__ = ['create']
+_idle_instances = dict()  # type: Dict[Tuple[str, str, str], List[Koala]]
+_idle_instances_lock = threading.Lock()
+
+
+@contextlib.contextmanager
+def acquire(
+        access_key: str,
+        model_path: Optional[str] = None,
+        library_path: Optional[str] = None) -> Iterator[Koala]:
+    """
+    Context manager lending a Koala instance from a process-wide pool. An idle instance created earlier with the same
+    `access_key`, `model_path` and `library_path` is reused if there is one, so short-lived users skip the cost of
+    initialization; otherwise a new instance is created. On exit, the instance is reset and returned to the pool.
+
+    The pool keeps every instance that has been returned to it until `clear_pool()` is called or the process exits.
+
+    :param access_key: AccessKey obtained from Picovoice Console (https://console.picovoice.ai/)
+    :param model_path: Absolute path to the file containing model parameters. If not set it will be set to the default
+    location.
+    :param library_path: Absolute path to Koala's dynamic library. If not set it will be set to the default location.
+    """
+
+    if model_path is None:
+        model_path = default_model_path()
+
+    if library_path is None:
+        library_path = default_library_path()
+
+    key = (access_key, model_path, library_path)
+    with _idle_instances_lock:
+        idle = _idle_instances.get(key)
+        koala = idle.pop() if idle else None
+
+    if koala is None:
+        koala = create(access_key=access_key, model_path=model_path, library_path=library_path)
+
+    try:
+        yield koala
+    except BaseException:
+        # The instance may have been left in an unknown state, so it is not returned to the pool.
+        koala.delete()
+        raise
+
+    try:
+        koala.reset()
+    except Exception:
+        koala.delete()
+        raise
+
+    with _idle_instances_lock:
+        _idle_instances.setdefault(key, list()).append(koala)
+
+
+def clear_pool() -> None:
+    """Deletes all idle instances held by the pool behind `acquire()`."""
+
+    with _idle_instances_lock:
+        instances = [koala for idle in _idle_instances.values() for koala in idle]
+        _idle_instances.clear()
+
+    for koala in instances:
+        koala.delete()
+
+
+atexit.register(clear_pool)
+
+
+__all__ = ['acquire', 'clear_pool', 'create']
@@ -9,10 +9,13 @@
 # specific language governing permissions and limitations under the License.
 #
 
+import array
 import os
+import sys
+import threading
 from ctypes import *
 from enum import Enum
-from typing import Sequence
+from typing import Any, Optional, Sequence
 
 
 class KoalaError(Exception):
@@ -63,9 +66,58 @@ class KoalaActivationRefusedError(KoalaError):
     pass
 
 
+# `memoryview.format` codes of native-endian 16-bit integers.
+_NATIVE_INT16_FORMATS = ('h', '@h', '=h', '<h' if sys.byteorder == 'little' else '>h')
+
+
+def is_int16_buffer(view: memoryview) -> bool:
+    """
+    Package-internal. Checks that `view` holds a one-dimensional run of native-endian 16-bit integers, the sample
+    layout every buffer-based entry point of the binding accepts. Contiguity is left to the caller.
+    """
+
+    return view.format in _NATIVE_INT16_FORMATS and view.ndim == 1
+
+
+def int16_samples(buffer: Any, name: str, writable: bool, length: Optional[int] = None) -> Any:
+    """
+    Package-internal. Maps a ctypes array of `c_short` over `buffer` without copying, after checking its layout with
+    `is_int16_buffer()`. A read-only buffer is copied instead, unless `writable` is set, in which case it is rejected.
+    `name` is used in error messages, and `length`, if set, is the required number of samples.
+    """
+
+    try:
+        view = memoryview(buffer)
+    except TypeError:
+        raise KoalaInvalidArgumentError("`%s` should support the buffer protocol" % name)
+
+    with view:
+        if not is_int16_buffer(view) or not view.c_contiguous:
+            raise KoalaInvalidArgumentError(
+                "`%s` should be a contiguous one-dimensional buffer of 16-bit integers" % name)
+        if length is not None and len(view) != length:
+            raise KoalaInvalidArgumentError(
+                "Length of `%s` %d does not match required length %d" % (name, len(view), length))
+
+        buffer_type = c_short * len(view)
+        if view.readonly:
+            if writable:
+                raise KoalaInvalidArgumentError("`%s` should be writable" % name)
+            return buffer_type.from_buffer_copy(buffer)
+        return buffer_type.from_buffer(buffer)
+
+
 class Koala(object):
     """
     Python binding for Koala noise-suppression engine.
+
+    Distinct instances are independent and may be used from different threads at the same time. Calls to `.process()`,
+    `.reset()` and `.delete()` on a single instance must not overlap. The remaining properties are immutable once the
+    instance is constructed and can be read from any thread.
+
+    The engine is loaded with `ctypes.CDLL`, which releases the GIL for the duration of every call into the library.
+    Threads each owning an instance therefore run `pv_koala_process` on separate cores in parallel, and only the
+    Python code between calls is serialized. `.process_into()` and `.process_buffer()` keep that code to a minimum.
     """
 
     class PicovoiceStatuses(Enum):
@@ -99,6 +151,46 @@ class Koala(object):
     class CKoala(Structure):
         pass
 
+    # Dynamic libraries loaded so far, keyed by their real path, so that every instance shares one handle and one set
+    # of function prototypes per library.
+    _libraries = dict()
+    _libraries_lock = threading.Lock()
+
+    @classmethod
+    def _load_library(cls, library_path: str) -> CDLL:
+        key = os.path.realpath(library_path)
+        with cls._libraries_lock:
+            library = cls._libraries.get(key)
+            if library is not None:
+                return library
+
+            library = cdll.LoadLibrary(library_path)
+
+            library.pv_koala_init.argtypes = [c_char_p, c_char_p, POINTER(POINTER(cls.CKoala))]
+            library.pv_koala_init.restype = cls.PicovoiceStatuses
+
+            library.pv_koala_delete.argtypes = [POINTER(cls.CKoala)]
+            library.pv_koala_delete.restype = None
+
+            library.pv_koala_delay_sample.argtypes = [POINTER(cls.CKoala), POINTER(c_int32)]
+            library.pv_koala_delay_sample.restype = cls.PicovoiceStatuses
+
+            library.pv_koala_process.argtypes = [
+                POINTER(cls.CKoala),
+                POINTER(c_short),
+                POINTER(c_short),
+            ]
+            library.pv_koala_process.restype = cls.PicovoiceStatuses
+
+            library.pv_koala_reset.argtypes = [POINTER(cls.CKoala)]
+            library.pv_koala_reset.restype = cls.PicovoiceStatuses
+
+            library.pv_koala_version.argtypes = []
+            library.pv_koala_version.restype = c_char_p
+
+            cls._libraries[key] = library
+            return library
+
     def __init__(
             self,
             access_key: str,
@@ -121,52 +213,37 @@ class Koala(object):
         if not os.path.exists(library_path):
             raise KoalaIOError("Could not find Koala's dynamic library at `%s`." % library_path)
 
-        library = cdll.LoadLibrary(library_path)
-
-        init_func = library.pv_koala_init
-        init_func.argtypes = [c_char_p, c_char_p, POINTER(POINTER(self.CKoala))]
-        init_func.restype = self.PicovoiceStatuses
+        library = self._load_library(library_path)
 
         self._handle = POINTER(self.CKoala)()
 
-        status = init_func(access_key.encode(), model_path.encode(), byref(self._handle))
+        status = library.pv_koala_init(access_key.encode(), model_path.encode(), byref(self._handle))
         if status is not self.PicovoiceStatuses.SUCCESS:
+            self._handle = None
             raise self._PICOVOICE_STATUS_TO_EXCEPTION[status]()
 
         self._delete_func = library.pv_koala_delete
-        self._delete_func.argtypes = [POINTER(self.CKoala)]
-        self._delete_func.restype = None
 
-        delay_sample_func = library.pv_koala_delay_sample
-        delay_sample_func.argtypes = [POINTER(self.CKoala), POINTER(c_int32)]
-        delay_sample_func.restype = self.PicovoiceStatuses
         delay_sample = c_int32()
-        status = delay_sample_func(self._handle, delay_sample)
+        status = library.pv_koala_delay_sample(self._handle, delay_sample)
         if status is not self.PicovoiceStatuses.SUCCESS:
             self.delete()
             raise self._PICOVOICE_STATUS_TO_EXCEPTION[status]()
         self._delay_sample = delay_sample.value
 
         self._process_func = library.pv_koala_process
-        self._process_func.argtypes = [
-            POINTER(self.CKoala),
-            POINTER(c_short),
-            POINTER(c_short),
-        ]
-        self._process_func.restype = self.PicovoiceStatuses
-
         self._reset_func = library.pv_koala_reset
-        self._reset_func.argtypes = [POINTER(self.CKoala)]
-        self._reset_func.restype = self.PicovoiceStatuses
 
         self._sample_rate = library.pv_sample_rate()
 
         self._frame_length = library.pv_koala_frame_length()
 
-        version_func = library.pv_koala_version
-        version_func.argtypes = []
-        version_func.restype = c_char_p
-        self._version = version_func().decode('utf-8')
+        # Reused by every call to `.process()`, which is safe since calls on one instance must not overlap.
+        frame_type = c_short * self._frame_length
+        self._pcm_frame = frame_type()
+        self._enhanced_pcm_frame = frame_type()
+
+        self._version = library.pv_koala_version().decode('utf-8')
 
     def process(self, pcm: Sequence[int]) -> Sequence[int]:
         """
@@ -187,16 +264,116 @@ class Koala(object):
             raise KoalaInvalidArgumentError(
                 "Length of input frame %d does not match required frame length %d" % (len(pcm), self.frame_length))
 
-        frame_type = c_short * self.frame_length
-        pcm = frame_type(*pcm)
-        enhanced_pcm = frame_type()
+        self._pcm_frame[:] = pcm
+
+        self._process_frame(self._pcm_frame, self._enhanced_pcm_frame)
+
+        # noinspection PyTypeChecker
+        return self._enhanced_pcm_frame[:]
+
+    def process_into(self, pcm: Any, enhanced_pcm: Any) -> None:
+        """
+        Processes a frame of audio and writes delayed enhanced audio into a caller-provided buffer. This is the same as
+        `.process()`, but both frames are passed to the engine in place rather than being converted element by element,
+        which makes it considerably faster when audio is already held in arrays.
+
+        :param pcm: A frame of audio samples in any object supporting the buffer protocol with native-endian 16-bit
+        integer items, such as a NumPy `int16` array, an `array.array('h')` or a `memoryview` of either. It must be
+        contiguous and hold exactly `.frame_length` samples. Read-only buffers are accepted, at the cost of one copy.
+        :param enhanced_pcm: A writable buffer with the same layout as `pcm` that receives the enhanced frame.
+        """
+
+        pcm = int16_samples(pcm, 'pcm', writable=False, length=self.frame_length)
+        enhanced_pcm = int16_samples(enhanced_pcm, 'enhanced_pcm', writable=True, length=self.frame_length)
+
+        self._process_frame(pcm, enhanced_pcm)
+
+    def process_buffer(self, pcm: Any, enhanced_pcm: Optional[Any] = None) -> Any:
+        """
+        Enhances a complete recording. The engine is reset, every frame of `pcm` is processed, followed by enough
+        silence to flush out the last `.delay_sample` samples, and the output is shifted by `.delay_sample` so that it
+        lines up with the input sample for sample. The engine is reset again before returning.
+
+        :param pcm: Audio samples of any length, in a buffer with the same layout as required by `.process_into()`.
+        :param enhanced_pcm: Optional writable buffer of the same length as `pcm` that receives the enhanced audio. It
+        must not overlap `pcm`. If not set, a new `array.array('h')` is allocated; wrap it with `numpy.frombuffer()` to
+        use it as a NumPy array without copying.
+        :return: The buffer holding the enhanced audio.
+        """
+
+        input_samples = int16_samples(pcm, 'pcm', writable=False)
+        num_samples = len(input_samples)
+        if enhanced_pcm is None:
+            enhanced_pcm = array.array('h', bytes(num_samples * sizeof(c_short)))
+        output_samples = int16_samples(enhanced_pcm, 'enhanced_pcm', writable=True, length=num_samples)
+
+        frame_length = self.frame_length
+        delay_sample = self.delay_sample
+        sample_size = sizeof(c_short)
+        frame_type = c_short * frame_length
+        padded_frame = frame_type()
+        delayed_frame = frame_type()
+
+        self.reset()
+
+        # Frames that lie entirely within the input and output are passed to the engine in place. Only the frames at
+        # either end, which reach past the recording, go through `padded_frame` and `delayed_frame`.
+        num_frames = (num_samples + delay_sample + frame_length - 1) // frame_length if num_samples > 0 else 0
+        for i in range(num_frames):
+            input_start = i * frame_length
+            if input_start + frame_length <= num_samples:
+                input_frame = frame_type.from_buffer(input_samples, input_start * sample_size)
+            else:
+                memset(padded_frame, 0, sizeof(padded_frame))
+                num_remaining = max(num_samples - input_start, 0)
+                if num_remaining > 0:
+                    memmove(
+                        padded_frame,
+                        addressof(input_samples) + input_start * sample_size,
+                        num_remaining * sample_size)
+                input_frame = padded_frame
+
+            output_start = input_start - delay_sample
+            is_output_in_place = 0 <= output_start and output_start + frame_length <= num_samples
+            if is_output_in_place:
+                output_frame = frame_type.from_buffer(output_samples, output_start * sample_size)
+            else:
+                output_frame = delayed_frame
+
+            try:
+                self._process_frame(input_frame, output_frame)
+            except KoalaError:
+                self.reset()
+                raise
+
+            if not is_output_in_place:
+                begin = max(output_start, 0)
+                end = min(output_start + frame_length, num_samples)
+                if end > begin:
+                    memmove(
+                        addressof(output_samples) + begin * sample_size,
+                        addressof(delayed_frame) + (begin - output_start) * sample_size,
+                        (end - begin) * sample_size)
+
+        self.reset()
+
+        return enhanced_pcm
+
+    def _process_frame(self, pcm: Any, enhanced_pcm: Any) -> None:
+        """
+        Package-internal. Runs the engine on one frame. Both arguments must already be ctypes arrays of
+        `.frame_length` samples, such as those returned by `int16_samples()`, and `enhanced_pcm` must be writable.
+        """
+
+        self._check_handle()
 
         status = self._process_func(self._handle, pcm, enhanced_pcm)
         if status is not self.PicovoiceStatuses.SUCCESS:
             raise self._PICOVOICE_STATUS_TO_EXCEPTION[status]()
 
-        # noinspection PyTypeChecker
-        return list(enhanced_pcm)
+    def _check_handle(self) -> None:
+        if self._handle is None:
+            raise KoalaInvalidStateError("Koala has been deleted")
 
     def reset(self) -> None:
         """
@@ -204,14 +381,24 @@ class Koala(object):
         Call this function in between calls to `process` that do not provide consecutive frames of audio.
         """
 
+        self._check_handle()
+
         status = self._reset_func(self._handle)
         if status is not self.PicovoiceStatuses.SUCCESS:
             raise self._PICOVOICE_STATUS_TO_EXCEPTION[status]()
 
     def delete(self) -> None:
-        """Releases resources acquired by Koala."""
+        """Releases resources acquired by Koala. Further calls have no effect."""
+
+        if self._handle is not None:
+            self._delete_func(self._handle)
+            self._handle = None
+
+    def __enter__(self) -> 'Koala':
+        return self
 
-        self._delete_func(self._handle)
+    def __exit__(self, *_: Any) -> None:
+        self.delete()
 
     @property
     def sample_rate(self) -> int:
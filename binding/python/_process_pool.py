@@ -0,0 +1,234 @@
+#
+# Copyright 2023 Picovoice Inc.
+#
+# You may not use this file except in compliance with the license. A copy of the license is located in the "LICENSE"
+# file accompanying this source.
+#
+# Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+# an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the
+# specific language governing permissions and limitations under the License.
+#
+
+import array
+import collections
+import multiprocessing
+import multiprocessing.util
+import os
+import sys
+import wave
+from typing import Any, Callable, List, Optional, Sequence
+
+from ._factory import create
+from ._koala import KoalaInvalidArgumentError, is_int16_buffer
+
+_SAMPLE_SIZE = array.array('h').itemsize
+
+# The Koala instance owned by a worker process, created once by `_init_worker` and reused for every task.
+_worker_koala = None
+
+
+def _init_worker(access_key: str, model_path: Optional[str], library_path: Optional[str]) -> None:
+    global _worker_koala
+
+    _worker_koala = create(access_key=access_key, model_path=model_path, library_path=library_path)
+    multiprocessing.util.Finalize(None, _worker_koala.delete, exitpriority=0)
+
+
+def _attach_shared_memory(name: str) -> Any:
+    from multiprocessing import shared_memory
+
+    if sys.version_info >= (3, 13):
+        return shared_memory.SharedMemory(name=name, track=False)
+    return shared_memory.SharedMemory(name=name)
+
+
+def _enhance_shared_memory(name: str, num_samples: int) -> None:
+    memory = _attach_shared_memory(name)
+    try:
+        _enhance_views(memory.buf, num_samples)
+    finally:
+        memory.close()
+
+
+def _enhance_views(buffer: memoryview, num_samples: int) -> None:
+    # Kept apart from `_enhance_shared_memory` so that every view into the shared memory is released before it closes.
+    num_bytes = num_samples * _SAMPLE_SIZE
+    _worker_koala.process_buffer(buffer[:num_bytes].cast('h'), buffer[num_bytes:2 * num_bytes].cast('h'))
+
+
+def _enhance_file(input_path: str, output_path: str) -> None:
+    with wave.open(input_path, 'rb') as f:
+        if f.getframerate() != _worker_koala.sample_rate:
+            raise KoalaInvalidArgumentError(
+                "Invalid sample rate of `%d` in `%s`. Koala only accepts `%d`" % (
+                    f.getframerate(),
+                    input_path,
+                    _worker_koala.sample_rate))
+        if f.getnchannels() != 1 or f.getsampwidth() != _SAMPLE_SIZE:
+            raise KoalaInvalidArgumentError("`%s` should be single-channel with 16-bit PCM encoding" % input_path)
+        pcm = array.array('h')
+        pcm.frombytes(f.readframes(f.getnframes()))
+
+    if sys.byteorder == 'big':
+        pcm.byteswap()
+    enhanced_pcm = _worker_koala.process_buffer(pcm)
+    if sys.byteorder == 'big':
+        enhanced_pcm.byteswap()
+
+    with wave.open(output_path, 'wb') as f:
+        f.setnchannels(1)
+        f.setsampwidth(_SAMPLE_SIZE)
+        f.setframerate(_worker_koala.sample_rate)
+        f.writeframes(enhanced_pcm.tobytes())
+
+
+class KoalaProcessPool(object):
+    """
+    Enhances many recordings in parallel on a pool of worker processes, each holding a long-lived Koala instance.
+
+    Every worker pays for `pv_koala_init` once, when the pool starts, and then processes recordings with
+    `Koala.process_buffer()`. Arrays are handed to workers through `multiprocessing.shared_memory` rather than being
+    pickled, which requires Python 3.8 or later; files are read and written by the workers themselves. Results come
+    back in input order. At most two tasks per worker are in flight at once, which bounds the shared memory in use.
+    """
+
+    def __init__(
+            self,
+            access_key: str,
+            model_path: Optional[str] = None,
+            library_path: Optional[str] = None,
+            num_processes: Optional[int] = None) -> None:
+        """
+        Constructor.
+
+        :param access_key: AccessKey obtained from Picovoice Console (https://console.picovoice.ai/)
+        :param model_path: Absolute path to the file containing model parameters. If not set it will be set to the
+        default location.
+        :param library_path: Absolute path to Koala's dynamic library. If not set it will be set to the default
+        location.
+        :param num_processes: Number of worker processes. Defaults to the number of CPUs.
+        """
+
+        self._num_processes = num_processes if num_processes is not None else (multiprocessing.cpu_count() or 1)
+        if self._num_processes < 1:
+            raise KoalaInvalidArgumentError("`num_processes` should be positive")
+
+        if os.name == 'posix' and sys.version_info >= (3, 8):
+            # Workers attaching to a shared memory segment register it with a resource tracker. Starting the tracker
+            # first lets workers inherit it, instead of each starting its own that would unlink the segments again when
+            # the worker exits.
+            from multiprocessing import resource_tracker
+            resource_tracker.ensure_running()
+
+        self._pool = multiprocessing.Pool(
+            processes=self._num_processes,
+            initializer=_init_worker,
+            initargs=(access_key, model_path, library_path))
+
+    def enhance(
+            self,
+            pcms: Sequence[Any],
+            progress_callback: Optional[Callable[[int, int], None]] = None) -> List[array.array]:
+        """
+        Enhances recordings held in memory.
+
+        :param pcms: Recordings, each in a buffer with the layout required by `Koala.process_buffer()`.
+        :param progress_callback: Optional function called with the number of finished recordings and the total after
+        each recording.
+        :return: The enhanced recordings in the same order, each aligned with its input and of the same length.
+        """
+
+        from multiprocessing import shared_memory
+
+        def submit(pcm: Any) -> Any:
+            view = memoryview(pcm)
+            with view:
+                if not is_int16_buffer(view) or not view.c_contiguous:
+                    raise KoalaInvalidArgumentError(
+                        "Recordings should be contiguous one-dimensional buffers of 16-bit integers")
+                num_samples = len(view)
+                memory = shared_memory.SharedMemory(create=True, size=max(2 * num_samples * _SAMPLE_SIZE, 1))
+                memory.buf[:num_samples * _SAMPLE_SIZE] = view.cast('B')
+            return memory, num_samples, self._pool.apply_async(_enhance_shared_memory, (memory.name, num_samples))
+
+        def collect(task: Any) -> array.array:
+            memory, num_samples, result = task
+            try:
+                result.get()
+                enhanced_pcm = array.array('h')
+                enhanced_pcm.frombytes(memory.buf[num_samples * _SAMPLE_SIZE:2 * num_samples * _SAMPLE_SIZE])
+                return enhanced_pcm
+            finally:
+                memory.close()
+                memory.unlink()
+
+        return self._run(pcms, submit, collect, progress_callback)
+
+    def enhance_files(
+            self,
+            input_paths: Sequence[str],
+            output_paths: Sequence[str],
+            progress_callback: Optional[Callable[[int, int], None]] = None) -> None:
+        """
+        Enhances single-channel, 16-bit `.wav` files recorded at `Koala.sample_rate`.
+
+        :param input_paths: Paths to the files to enhance.
+        :param output_paths: Paths where the enhanced files are written, one per input path.
+        :param progress_callback: Optional function called with the number of finished files and the total after each
+        file.
+        """
+
+        if len(input_paths) != len(output_paths):
+            raise KoalaInvalidArgumentError("`input_paths` and `output_paths` should have the same length")
+
+        self._run(
+            list(zip(input_paths, output_paths)),
+            lambda paths: self._pool.apply_async(_enhance_file, paths),
+            lambda result: result.get(),
+            progress_callback)
+
+    def _run(
+            self,
+            items: Sequence[Any],
+            submit: Callable[[Any], Any],
+            collect: Callable[[Any], Any],
+            progress_callback: Optional[Callable[[int, int], None]]) -> List[Any]:
+        max_in_flight = 2 * self._num_processes
+        in_flight = collections.deque()
+        results = list()
+        try:
+            for item in items:
+                if len(in_flight) == max_in_flight:
+                    results.append(collect(in_flight.popleft()))
+                    if progress_callback is not None:
+                        progress_callback(len(results), len(items))
+                in_flight.append(submit(item))
+
+            while len(in_flight) > 0:
+                results.append(collect(in_flight.popleft()))
+                if progress_callback is not None:
+                    progress_callback(len(results), len(items))
+        finally:
+            # Tasks left behind by an error still need their resources released.
+            for task in in_flight:
+                try:
+                    collect(task)
+                except Exception:
+                    pass
+
+        return results
+
+    def close(self) -> None:
+        """Stops the worker processes and releases their Koala instances."""
+
+        self._pool.close()
+        self._pool.join()
+
+    def __enter__(self) -> 'KoalaProcessPool':
+        return self
+
+    def __exit__(self, *_: Any) -> None:
+        self.close()
+
+
+__all__ = ['KoalaProcessPool']
@@ -0,0 +1,338 @@
+#
+# Copyright 2023 Picovoice Inc.
+#
+# You may not use this file except in compliance with the license. A copy of the license is located in the "LICENSE"
+# file accompanying this source.
+#
+# Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+# an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the
+# specific language governing permissions and limitations under the License.
+#
+
+import array
+import asyncio
+import os
+import threading
+from concurrent.futures import Executor, ThreadPoolExecutor
+from ctypes import addressof, c_short, memmove, memset, sizeof
+from typing import Any, Optional
+
+from ._koala import Koala, KoalaInvalidArgumentError, int16_samples, is_int16_buffer
+
+_SAMPLE_SIZE = array.array('h').itemsize
+
+# `asyncio.get_running_loop()` was added in Python 3.7. Within a coroutine, `get_event_loop()` returns the same loop.
+_get_running_loop = getattr(asyncio, 'get_running_loop', asyncio.get_event_loop)
+
+_default_executor = None
+_default_executor_lock = threading.Lock()
+
+
+def _get_default_executor() -> Executor:
+    global _default_executor
+
+    with _default_executor_lock:
+        if _default_executor is None:
+            _default_executor = ThreadPoolExecutor(max_workers=os.cpu_count() or 1)
+        return _default_executor
+
+
+class KoalaStream(object):
+    """
+    Enhances a stream of audio delivered in chunks of any length, hiding the frame size and delay of Koala.
+
+    Each call to `.process()` takes the next chunk of the input and returns the enhanced audio that has become
+    available, already aligned with the input: the first sample returned is the enhanced version of the first sample
+    written, and so on. Since Koala looks ahead by `.delay_sample` samples, the last `.delay_sample` samples of the
+    input are only returned by `.close()`, which flushes them out of the engine. Over a whole stream, the enhanced
+    audio has exactly as many samples as the input.
+
+    Full frames are passed to the engine in place from the chunk they arrive in; only the samples of a frame split
+    across two chunks are staged in a frame-sized buffer allocated once. Enhanced chunks are `array.array('h')`
+    objects; wrap them with `numpy.frombuffer()` to use them as NumPy arrays without copying.
+
+    The stream borrows `koala` and resets it, both when created and when closed. The instance must not be used
+    elsewhere in between, and deleting it remains the caller's responsibility. After `.close()` the stream can be
+    used again for a new recording.
+    """
+
+    def __init__(self, koala: Koala) -> None:
+        """
+        Constructor.
+
+        :param koala: Koala instance used to enhance the stream.
+        """
+
+        self._koala = koala
+        self._frame_length = koala.frame_length
+        self._delay_sample = koala.delay_sample
+        self._frame_type = c_short * self._frame_length
+        self._staged_frame = self._frame_type()
+        self._delayed_frame = self._frame_type()
+
+        self._num_staged_samples = 0
+        self._num_written_samples = 0
+        self._num_processed_samples = 0
+        self._num_emitted_samples = 0
+
+        self._koala.reset()
+
+    def process(self, pcm: Any) -> array.array:
+        """
+        Enhances the next chunk of the stream.
+
+        :param pcm: Audio samples of any length, in a buffer with the same layout as required by
+        `Koala.process_into()`.
+        :return: The enhanced audio that has become available, following on from the audio returned by the previous
+        call. It may be shorter or longer than `pcm`, and is empty until more than `.delay_sample` samples have been
+        written.
+        """
+
+        samples = int16_samples(pcm, 'pcm', writable=False)
+        num_samples = len(samples)
+        self._num_written_samples += num_samples
+
+        num_frames = (self._num_staged_samples + num_samples) // self._frame_length
+        enhanced_pcm = self._allocate(self._num_processed_samples + num_frames * self._frame_length)
+        output_address, num_output_samples = enhanced_pcm.buffer_info()
+
+        offset = 0
+        if self._num_staged_samples > 0 and num_frames > 0:
+            offset = self._frame_length - self._num_staged_samples
+            self._stage(samples, 0, offset)
+            self._enhance(self._staged_frame, output_address, num_output_samples)
+            self._num_staged_samples = 0
+
+        input_address = addressof(samples)
+        while offset + self._frame_length <= num_samples:
+            input_frame = self._frame_type.from_address(input_address + offset * _SAMPLE_SIZE)
+            self._enhance(input_frame, output_address, num_output_samples)
+            offset += self._frame_length
+
+        self._stage(samples, offset, num_samples - offset)
+
+        self._num_emitted_samples += len(enhanced_pcm)
+        return enhanced_pcm
+
+    def close(self) -> array.array:
+        """
+        Ends the stream, flushing the enhanced audio still held back by the delay of Koala, and resets Koala so that a
+        new stream can start.
+
+        :return: The remaining enhanced audio.
+        """
+
+        # Silence completes the staged frame and pushes the final `.delay_sample` samples out of the engine.
+        num_required_samples = self._num_written_samples + self._delay_sample
+        enhanced_pcm = self._allocate(num_required_samples)
+        output_address, num_output_samples = enhanced_pcm.buffer_info()
+
+        memset(
+            addressof(self._staged_frame) + self._num_staged_samples * _SAMPLE_SIZE,
+            0,
+            (self._frame_length - self._num_staged_samples) * _SAMPLE_SIZE)
+        while self._num_processed_samples < num_required_samples:
+            self._enhance(self._staged_frame, output_address, num_output_samples)
+            memset(self._staged_frame, 0, sizeof(self._staged_frame))
+
+        self._koala.reset()
+        self._num_staged_samples = 0
+        self._num_written_samples = 0
+        self._num_processed_samples = 0
+        self._num_emitted_samples = 0
+
+        return enhanced_pcm
+
+    def _allocate(self, num_processed_samples: int) -> array.array:
+        # Room for every aligned sample not yet returned once `num_processed_samples` samples have been processed.
+        num_samples = num_processed_samples - self._delay_sample - self._num_emitted_samples
+        return array.array('h', bytes(max(num_samples, 0) * _SAMPLE_SIZE))
+
+    def _stage(self, samples: Any, offset: int, num_samples: int) -> None:
+        if num_samples > 0:
+            memmove(
+                addressof(self._staged_frame) + self._num_staged_samples * _SAMPLE_SIZE,
+                addressof(samples) + offset * _SAMPLE_SIZE,
+                num_samples * _SAMPLE_SIZE)
+            self._num_staged_samples += num_samples
+
+    def _enhance(self, frame: Any, output_address: int, num_output_samples: int) -> None:
+        # Position of the enhanced frame within the output, once the delay is taken into account.
+        output_start = self._num_processed_samples - self._delay_sample - self._num_emitted_samples
+        self._num_processed_samples += self._frame_length
+
+        # Both buffers are already validated, so the engine is run directly on frames mapped over them.
+        is_output_in_place = 0 <= output_start and output_start + self._frame_length <= num_output_samples
+        if is_output_in_place:
+            output_frame = self._frame_type.from_address(output_address + output_start * _SAMPLE_SIZE)
+        else:
+            output_frame = self._delayed_frame
+
+        self._koala._process_frame(frame, output_frame)
+
+        if not is_output_in_place:
+            begin = max(output_start, 0)
+            end = min(output_start + self._frame_length, num_output_samples)
+            if end > begin:
+                memmove(
+                    output_address + begin * _SAMPLE_SIZE,
+                    addressof(self._delayed_frame) + (begin - output_start) * _SAMPLE_SIZE,
+                    (end - begin) * _SAMPLE_SIZE)
+
+
+class KoalaAsyncStream(object):
+    """
+    Enhances a stream of audio from asyncio code without blocking the event loop.
+
+    Chunks of any length are passed to `.write()`, and enhanced audio is read back by iterating over the stream with
+    `async for`. Enhanced chunks are `array.array('h')` objects whose boundaries need not match the written chunks, but
+    the enhanced stream is aligned with the input sample for sample: the `.delay_sample` of Koala is already removed.
+    `.close()` marks the end of the input and flushes the remaining audio, after which the enhanced stream has exactly
+    as many samples as were written.
+
+    Processing is done by a `KoalaStream` on an executor thread, where calls into Koala release the GIL, so many streams
+    in one process spread over all cores. Both directions are bounded queues: `.write()` waits while `max_queued_chunks`
+    chunks are pending, and processing pauses while as many enhanced chunks are waiting to be read.
+
+    The stream borrows `koala` and resets it on first use. The instance must not be used elsewhere until the stream
+    has been read to the end or `.aclose()` has returned, and deleting it remains the caller's responsibility.
+    """
+
+    def __init__(self, koala: Koala, executor: Optional[Executor] = None, max_queued_chunks: int = 16) -> None:
+        """
+        Constructor.
+
+        :param koala: Koala instance used to enhance the stream.
+        :param executor: Executor running the calls into Koala. Defaults to a thread pool shared by all streams, with
+        one thread per CPU.
+        :param max_queued_chunks: Maximum number of chunks waiting to be processed, and of enhanced chunks waiting to be
+        read.
+        """
+
+        if max_queued_chunks < 1:
+            raise KoalaInvalidArgumentError("`max_queued_chunks` should be positive")
+
+        self._koala = koala
+        self._executor = executor
+        self._max_queued_chunks = max_queued_chunks
+        self._input_queue = None
+        self._output_queue = None
+        self._task = None
+        self._is_closed = False
+        self._is_aborted = False
+        self._error = None
+
+    async def write(self, pcm: Any) -> None:
+        """
+        Queues a chunk of audio for enhancement, waiting while the input queue is full.
+
+        :param pcm: Audio samples of any length in a buffer of native 16-bit integers, such as a NumPy `int16` array
+        or an `array.array('h')`. The samples are copied, so the buffer can be reused as soon as this returns.
+        """
+
+        if self._is_closed:
+            raise KoalaInvalidArgumentError("Cannot write to a closed stream")
+
+        try:
+            view = memoryview(pcm)
+        except TypeError:
+            raise KoalaInvalidArgumentError("`pcm` should support the buffer protocol")
+        with view:
+            if not is_int16_buffer(view):
+                raise KoalaInvalidArgumentError("`pcm` should be a one-dimensional buffer of 16-bit integers")
+            chunk = array.array('h', view.tobytes())
+
+        self._start()
+        await self._input_queue.put(chunk)
+
+    async def close(self) -> None:
+        """Marks the end of the input. The enhanced stream ends once the remaining audio has been flushed."""
+
+        if not self._is_closed:
+            self._is_closed = True
+            self._start()
+            await self._input_queue.put(None)
+
+    async def aclose(self) -> None:
+        """
+        Stops the stream without flushing it, for readers that stop iterating before the end. Queued input and unread
+        enhanced audio are discarded, and iterating afterwards ends immediately. Once this returns, no call into Koala
+        is in progress, so the instance can be reused or deleted.
+        """
+
+        self._is_closed = True
+        self._is_aborted = True
+        if self._task is not None and not self._task.done():
+            self._task.cancel()
+            try:
+                await self._task
+            except asyncio.CancelledError:
+                pass
+
+    def __aiter__(self) -> 'KoalaAsyncStream':
+        return self
+
+    async def __anext__(self) -> array.array:
+        if self._is_aborted:
+            raise StopAsyncIteration
+        # A failed stream stays failed: `_run` puts its error on the queue only once.
+        if self._error is not None:
+            raise self._error
+
+        self._start()
+        item = await self._output_queue.get()
+        if item is None:
+            await self._output_queue.put(None)
+            raise StopAsyncIteration
+        if isinstance(item, BaseException):
+            self._error = item
+            raise item
+        return item
+
+    def _start(self) -> None:
+        if self._task is None:
+            self._input_queue = asyncio.Queue(maxsize=self._max_queued_chunks)
+            self._output_queue = asyncio.Queue(maxsize=self._max_queued_chunks)
+            self._task = asyncio.ensure_future(self._run())
+
+    @staticmethod
+    async def _call(executor: Executor, func: Any, *args: Any) -> Any:
+        future = _get_running_loop().run_in_executor(executor, func, *args)
+        try:
+            return await asyncio.shield(future)
+        except asyncio.CancelledError:
+            # The executor thread cannot be interrupted, and may still be inside Koala. Wait for it so that a
+            # cancelled stream never outlives its calls into the borrowed instance.
+            await asyncio.wait([future])
+            raise
+
+    async def _run(self) -> None:
+        executor = self._executor if self._executor is not None else _get_default_executor()
+
+        is_final = False
+        try:
+            stream = await self._call(executor, KoalaStream, self._koala)
+
+            while not is_final:
+                chunk = await self._input_queue.get()
+                if chunk is None:
+                    is_final = True
+                    enhanced_pcm = await self._call(executor, stream.close)
+                else:
+                    enhanced_pcm = await self._call(executor, stream.process, chunk)
+
+                if len(enhanced_pcm) > 0:
+                    await self._output_queue.put(enhanced_pcm)
+
+            await self._output_queue.put(None)
+        except Exception as e:
+            await self._output_queue.put(e)
+            # Keep accepting input so that writers waiting on a full queue are released.
+            while not is_final:
+                is_final = (await self._input_queue.get()) is None
+
+
+__all__ = [
+    'KoalaAsyncStream',
+    'KoalaStream',
+]
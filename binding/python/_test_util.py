@@ -0,0 +1,28 @@
+#
+#    Copyright 2023 Picovoice Inc.
+#
+#    You may not use this file except in compliance with the license. A copy of the license is located in the "LICENSE"
+#    file accompanying this source.
+#
+#    Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+#    an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the
+#    specific language governing permissions and limitations under the License.
+#
+
+"""
+Registers this directory as the `pvkoala` package, the name it is installed under, so that the tests import the
+binding the way users do. Worker processes spawned by `multiprocessing` re-run the test module, and with it this
+registration.
+"""
+
+import importlib.util
+import os
+import sys
+
+if 'pvkoala' not in sys.modules:
+    _spec = importlib.util.spec_from_file_location(
+        'pvkoala',
+        os.path.join(os.path.dirname(os.path.abspath(__file__)), '__init__.py'))
+    _package = importlib.util.module_from_spec(_spec)
+    sys.modules['pvkoala'] = _package
+    _spec.loader.exec_module(_package)
@@ -14,7 +14,14 @@ import shutil
 
 import setuptools
 
-INCLUDE_FILES = ('../../LICENSE', '__init__.py', '_factory.py', '_koala.py', '_util.py')
+INCLUDE_FILES = (
+    '../../LICENSE',
+    '__init__.py',
+    '_factory.py',
+    '_koala.py',
+    '_process_pool.py',
+    '_stream.py',
+    '_util.py')
 INCLUDE_LIBS = ('common', 'jetson', 'linux', 'mac', 'raspberry-pi', 'windows')
 
 os.system('git clean -dfx')
@@ -42,7 +49,7 @@ with open(os.path.join(os.path.dirname(__file__), 'README.md'), 'r') as f:
 
 setuptools.setup(
     name="pvkoala",
-    version="1.0.0",
+    version="1.1.0",
     author="Picovoice",
     author_email="hello@picovoice.ai",
     description="Koala Noise Suppression Engine.",
@@ -9,16 +9,32 @@
 #    specific language governing permissions and limitations under the License.
 #
 import argparse
+import array
+import asyncio
 import math
 import os
+import random
 import struct
 import sys
+import tempfile
 import unittest
 import wave
+from concurrent.futures import ThreadPoolExecutor
 from typing import Optional, Sequence
 
-from _koala import Koala
-from _util import default_library_path, default_model_path
+import _test_util
+from pvkoala import (
+    Koala,
+    KoalaAsyncStream,
+    KoalaInvalidArgumentError,
+    KoalaInvalidStateError,
+    KoalaProcessPool,
+    KoalaStream,
+    acquire,
+    clear_pool,
+    default_library_path,
+    default_model_path
+)
 
 
 class KoalaTestCase(unittest.TestCase):
@@ -106,6 +122,286 @@ class KoalaTestCase(unittest.TestCase):
             output_frame = self.koala.process(input_frame)
             self.assertTrue(all(x == y for x, y in zip(output_frame, reference_frames.pop(0))))
 
+    def test_process_into(self) -> None:
+        frame_length = self.koala.frame_length
+        num_frames = len(self.test_pcm) // frame_length
+
+        self.koala.reset()
+        reference_frames = []
+        for i in range(num_frames):
+            reference_frames.append(self.koala.process(self.test_pcm[i * frame_length:(i + 1) * frame_length]))
+
+        input_pcm = array.array('h', self.test_pcm[:num_frames * frame_length])
+        readonly_pcm = input_pcm.tobytes()
+        enhanced_frame = array.array('h', [0] * frame_length)
+
+        self.koala.reset()
+        for i in range(num_frames):
+            if i % 2 == 0:
+                frame = memoryview(input_pcm)[i * frame_length:(i + 1) * frame_length]
+            else:
+                frame = memoryview(readonly_pcm).cast('h')[i * frame_length:(i + 1) * frame_length]
+            self.koala.process_into(frame, enhanced_frame)
+            self.assertEqual(list(enhanced_frame), reference_frames[i])
+
+    def test_process_into_invalid(self) -> None:
+        frame_length = self.koala.frame_length
+        frame = array.array('h', [0] * frame_length)
+
+        with self.assertRaises(KoalaInvalidArgumentError):
+            self.koala.process_into(array.array('h', [0] * (frame_length - 1)), frame)
+        with self.assertRaises(KoalaInvalidArgumentError):
+            self.koala.process_into(array.array('i', [0] * frame_length), frame)
+        with self.assertRaises(KoalaInvalidArgumentError):
+            self.koala.process_into(frame, bytes(frame_length * 2))
+        with self.assertRaises(KoalaInvalidArgumentError):
+            self.koala.process_into([0] * frame_length, frame)
+
+    def _process_aligned(self, pcm: Sequence[int]) -> Sequence[int]:
+        frame_length = self.koala.frame_length
+        delay_sample = self.koala.delay_sample
+        num_frames = (len(pcm) + delay_sample + frame_length - 1) // frame_length
+        padded_pcm = list(pcm) + [0] * (num_frames * frame_length - len(pcm))
+
+        self.koala.reset()
+        enhanced_pcm = []
+        for i in range(num_frames):
+            enhanced_pcm.extend(self.koala.process(padded_pcm[i * frame_length:(i + 1) * frame_length]))
+        self.koala.reset()
+
+        return enhanced_pcm[delay_sample:delay_sample + len(pcm)]
+
+    def test_process_buffer(self) -> None:
+        for num_samples in (len(self.test_pcm), len(self.test_pcm) - self.koala.frame_length // 2, 1, 0):
+            pcm = array.array('h', self.test_pcm[:num_samples])
+            reference_pcm = self._process_aligned(pcm)
+
+            enhanced_pcm = self.koala.process_buffer(pcm)
+            self.assertEqual(len(enhanced_pcm), num_samples)
+            self.assertEqual(list(enhanced_pcm), reference_pcm)
+
+            enhanced_pcm = array.array('h', [0] * num_samples)
+            readonly_pcm = memoryview(pcm.tobytes()).cast('h')
+            self.assertIs(self.koala.process_buffer(readonly_pcm, enhanced_pcm), enhanced_pcm)
+            self.assertEqual(list(enhanced_pcm), reference_pcm)
+
+        with self.assertRaises(KoalaInvalidArgumentError):
+            self.koala.process_buffer(array.array('h', [0] * 10), array.array('h', [0] * 9))
+
+    def test_concurrent_instances(self) -> None:
+        num_threads = 4
+        pcm = array.array('h', self.test_pcm)
+        reference_pcm = list(self.koala.process_buffer(pcm))
+
+        instances = [
+            Koala(
+                access_key=self.access_key,
+                model_path=default_model_path('../..'),
+                library_path=default_library_path('../..'))
+            for _ in range(num_threads)
+        ]
+        try:
+            with ThreadPoolExecutor(max_workers=num_threads) as executor:
+                results = list(executor.map(lambda koala: [koala.process_buffer(pcm) for _ in range(4)], instances))
+        finally:
+            for koala in instances:
+                koala.delete()
+
+        for enhanced_pcms in results:
+            for enhanced_pcm in enhanced_pcms:
+                self.assertEqual(list(enhanced_pcm), reference_pcm)
+
+    def test_stream(self) -> None:
+        frame_length = self.koala.frame_length
+        stream = KoalaStream(self.koala)
+        chunk_rng = random.Random(0)
+        chunk_lengths = (1, frame_length - 1, frame_length, 3 * frame_length + 5)
+
+        for num_samples in (len(self.test_pcm), frame_length * 3, 1, 0):
+            pcm = array.array('h', self.test_pcm[:num_samples])
+            reference_pcm = list(self.koala.process_buffer(pcm))
+            self.koala.reset()
+
+            enhanced_pcm = []
+            start = 0
+            while start < num_samples:
+                end = min(start + chunk_rng.choice(chunk_lengths), num_samples)
+                chunk = stream.process(pcm[start:end])
+                self.assertLessEqual(len(enhanced_pcm) + len(chunk), max(end - self.koala.delay_sample, 0))
+                enhanced_pcm.extend(chunk)
+                start = end
+            enhanced_pcm.extend(stream.close())
+
+            self.assertEqual(enhanced_pcm, reference_pcm)
+
+        with self.assertRaises(KoalaInvalidArgumentError):
+            stream.process([0] * frame_length)
+
+    def test_stream_deleted(self) -> None:
+        koala = Koala(
+            access_key=self.access_key,
+            model_path=default_model_path('../..'),
+            library_path=default_library_path('../..'))
+        stream = KoalaStream(koala)
+        koala.delete()
+
+        pcm = array.array('h', self.test_pcm[:koala.frame_length])
+        with self.assertRaises(KoalaInvalidStateError):
+            stream.process(pcm)
+        with self.assertRaises(KoalaInvalidStateError):
+            koala.process_buffer(pcm)
+
+    @staticmethod
+    async def _run_async_stream(koala: Koala, pcm: Sequence[int], seed: int) -> Sequence[int]:
+        stream = KoalaAsyncStream(koala, max_queued_chunks=2)
+        chunk_rng = random.Random(seed)
+
+        async def write() -> None:
+            start = 0
+            while start < len(pcm):
+                end = min(start + chunk_rng.randint(1, 1000), len(pcm))
+                await stream.write(array.array('h', pcm[start:end]))
+                start = end
+            await stream.close()
+
+        enhanced_pcm = []
+        writer = asyncio.ensure_future(write())
+        async for chunk in stream:
+            enhanced_pcm.extend(chunk)
+        await writer
+
+        return enhanced_pcm
+
+    def test_async_stream(self) -> None:
+        pcm = array.array('h', self.test_pcm)
+        reference_pcm = list(self.koala.process_buffer(pcm))
+
+        instances = [
+            Koala(
+                access_key=self.access_key,
+                model_path=default_model_path('../..'),
+                library_path=default_library_path('../..'))
+            for _ in range(3)
+        ]
+
+        async def run_streams() -> Sequence[Sequence[int]]:
+            return await asyncio.gather(*[self._run_async_stream(koala, pcm, i) for i, koala in enumerate(instances)])
+
+        try:
+            results = asyncio.run(run_streams())
+        finally:
+            for koala in instances:
+                koala.delete()
+
+        for enhanced_pcm in results:
+            self.assertEqual(enhanced_pcm, reference_pcm)
+
+    def test_async_stream_error(self) -> None:
+        class FailingKoala(object):
+            frame_length = self.koala.frame_length
+            delay_sample = self.koala.delay_sample
+
+            def reset(self) -> None:
+                raise KoalaInvalidArgumentError()
+
+        async def run_stream() -> None:
+            stream = KoalaAsyncStream(FailingKoala())
+            await stream.write(array.array('h', [0] * 10))
+            await stream.close()
+            for _ in range(2):
+                with self.assertRaises(KoalaInvalidArgumentError):
+                    await asyncio.wait_for(stream.__anext__(), timeout=10)
+
+        asyncio.run(run_stream())
+
+    def test_async_stream_aclose(self) -> None:
+        koala = Koala(
+            access_key=self.access_key,
+            model_path=default_model_path('../..'),
+            library_path=default_library_path('../..'))
+
+        async def run_stream() -> None:
+            stream = KoalaAsyncStream(koala, max_queued_chunks=1)
+            frame = array.array('h', self.test_pcm[:koala.frame_length])
+            for _ in range(4):
+                await stream.write(frame)
+
+            # The reader stops after one chunk, leaving the stream blocked on its full output queue.
+            await asyncio.wait_for(stream.__anext__(), timeout=10)
+            await asyncio.wait_for(stream.aclose(), timeout=10)
+
+            self.assertTrue(stream._task.done())
+            with self.assertRaises(StopAsyncIteration):
+                await stream.__anext__()
+            with self.assertRaises(KoalaInvalidArgumentError):
+                await stream.write(frame)
+
+        try:
+            asyncio.run(run_stream())
+            koala.process(self.test_pcm[:koala.frame_length])
+        finally:
+            koala.delete()
+
+    @unittest.skipIf(sys.version_info < (3, 8), "`multiprocessing.shared_memory` requires Python 3.8")
+    def test_process_pool(self) -> None:
+        frame_length = self.koala.frame_length
+        pcms = [
+            array.array('h', self.test_pcm),
+            array.array('h', self.noise_pcm[:len(self.noise_pcm) // 2]),
+            array.array('h', self.test_pcm[:frame_length * 3 + 7]),
+        ]
+        reference_pcms = [list(self.koala.process_buffer(pcm)) for pcm in pcms]
+
+        progress = []
+        with KoalaProcessPool(
+                access_key=self.access_key,
+                model_path=default_model_path('../..'),
+                library_path=default_library_path('../..'),
+                num_processes=2) as pool:
+            enhanced_pcms = pool.enhance(pcms, progress_callback=lambda done, total: progress.append((done, total)))
+            self.assertEqual([list(x) for x in enhanced_pcms], reference_pcms)
+            self.assertEqual(progress, [(1, 3), (2, 3), (3, 3)])
+
+            with tempfile.TemporaryDirectory() as output_dir:
+                output_paths = [os.path.join(output_dir, '%d.wav' % i) for i in range(2)]
+                pool.enhance_files([self.AUDIO_PATH, self.NOISE_PATH], output_paths)
+                self.assertEqual(
+                    list(self.load_wav_resource(output_paths[0])),
+                    list(self.koala.process_buffer(array.array('h', self.test_pcm))))
+                self.assertEqual(
+                    list(self.load_wav_resource(output_paths[1])),
+                    list(self.koala.process_buffer(array.array('h', self.noise_pcm))))
+
+    def test_context_manager(self) -> None:
+        with Koala(
+                access_key=self.access_key,
+                model_path=default_model_path('../..'),
+                library_path=default_library_path('../..')) as koala:
+            koala.process([0] * koala.frame_length)
+        koala.delete()
+
+        self.assertEqual(len(Koala._libraries), 1)
+
+    def test_instance_pool(self) -> None:
+        kwargs = dict(
+            access_key=self.access_key,
+            model_path=default_model_path('../..'),
+            library_path=default_library_path('../..'))
+
+        with acquire(**kwargs) as first:
+            with acquire(**kwargs) as second:
+                self.assertIsNot(first, second)
+            reference_frame = first.process(self.test_pcm[:first.frame_length])
+
+        with acquire(**kwargs) as koala:
+            self.assertIn(koala, (first, second))
+            self.assertEqual(koala.process(self.test_pcm[:koala.frame_length]), reference_frame)
+
+        clear_pool()
+        with acquire(**kwargs) as koala:
+            self.assertNotIn(koala, (first, second))
+        clear_pool()
+
     def test_version(self) -> None:
         version = self.koala.version
         self.assertIsInstance(version, str)
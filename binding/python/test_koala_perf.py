@@ -10,62 +10,397 @@
 #
 
 import argparse
+import array
+import glob
+import json
 import os
 import struct
+import subprocess
 import sys
+import threading
 import unittest
 import wave
+from concurrent.futures import ThreadPoolExecutor
+from ctypes import c_short
 from time import perf_counter
+from typing import Any, Callable, Dict, List, Optional, Sequence
 
-from _koala import Koala
-from _util import default_library_path, default_model_path
+import _test_util
+from pvkoala import Koala, KoalaStream, default_library_path, default_model_path
+
+
+class MachineStateSampler(object):
+    """
+    Samples CPU frequency, temperature, load and throttling state before, during and after a benchmark run, using the
+    same fields as `koala_machine_state.h` in the C demos. Fields that cannot be read on the current machine are `None`.
+    Throttling is detected from the per-core `thermal_throttle` counters of x86 Linux kernels and from the firmware
+    flags reported by `vcgencmd get_throttled` on Raspberry Pi.
+    """
+
+    # Raspberry Pi firmware flags: frequency capped, currently throttled, soft temperature limit active.
+    PI_THROTTLED_NOW = 0x0000E
+    # The same three conditions, latched since boot.
+    PI_THROTTLED_SINCE_BOOT = 0xE0000
+
+    def __init__(self, interval_sec: float = 0.5) -> None:
+        self._interval_sec = interval_sec
+        self._samples: List[Dict[str, Any]] = list()
+        self._start_sec = 0.
+        self._stop_event = threading.Event()
+        self._thread: Optional[threading.Thread] = None
+
+    def __enter__(self) -> 'MachineStateSampler':
+        self._start_sec = perf_counter()
+        self._samples = [self._sample()]
+        self._stop_event.clear()
+        self._thread = threading.Thread(target=self._run, daemon=True)
+        self._thread.start()
+        return self
+
+    def __exit__(self, *_: Any) -> None:
+        self._stop_event.set()
+        self._thread.join()
+        self._samples.append(self._sample())
+
+    def _run(self) -> None:
+        while not self._stop_event.wait(self._interval_sec):
+            self._samples.append(self._sample())
+
+    @staticmethod
+    def _read_file(path: str) -> Optional[str]:
+        try:
+            with open(path, 'r') as f:
+                return f.read().strip()
+        except (OSError, ValueError):
+            return None
+
+    @classmethod
+    def _read_throttled_flags(cls) -> Optional[int]:
+        value = cls._read_file('/sys/devices/platform/soc/soc:firmware/get_throttled')
+        if value is not None:
+            return int(value, 16)
+        try:
+            output = subprocess.check_output(['vcgencmd', 'get_throttled'], stderr=subprocess.DEVNULL, timeout=1)
+            return int(output.decode('utf-8').strip().split('=')[1], 16)
+        except (OSError, subprocess.SubprocessError, IndexError, ValueError):
+            return None
+
+    def _sample(self) -> Dict[str, Any]:
+        frequencies_mhz = list()
+        throttle_counts = list()
+        for cpu_dir in glob.glob('/sys/devices/system/cpu/cpu[0-9]*'):
+            frequency = self._read_file(os.path.join(cpu_dir, 'cpufreq/scaling_cur_freq'))
+            if frequency is not None:
+                frequencies_mhz.append(int(frequency) * 1e-3)
+            throttle_count = self._read_file(os.path.join(cpu_dir, 'thermal_throttle/core_throttle_count'))
+            if throttle_count is not None:
+                throttle_counts.append(int(throttle_count))
+
+        temperatures = list()
+        for zone in glob.glob('/sys/class/thermal/thermal_zone[0-9]*/temp'):
+            temperature = self._read_file(zone)
+            if temperature:
+                temperatures.append(int(temperature) * 1e-3)
+
+        try:
+            load_average = os.getloadavg()[0]
+        except (AttributeError, OSError):
+            load_average = None
+
+        return {
+            'elapsed_sec': perf_counter() - self._start_sec,
+            'min_cpu_frequency_mhz': min(frequencies_mhz) if len(frequencies_mhz) > 0 else None,
+            'mean_cpu_frequency_mhz': sum(frequencies_mhz) / len(frequencies_mhz) if len(frequencies_mhz) > 0 else None,
+            'max_temperature_celsius': max(temperatures) if len(temperatures) > 0 else None,
+            'load_average': load_average,
+            'throttle_count': sum(throttle_counts) if len(throttle_counts) > 0 else None,
+            'throttled_flags': self._read_throttled_flags(),
+        }
+
+    @property
+    def throttled(self) -> bool:
+        first = self._samples[0]
+        last = self._samples[-1]
+
+        if first['throttle_count'] is not None and last['throttle_count'] is not None:
+            if last['throttle_count'] > first['throttle_count']:
+                return True
+
+        for sample in self._samples:
+            if sample['throttled_flags'] is not None and (sample['throttled_flags'] & self.PI_THROTTLED_NOW):
+                return True
+
+        if first['throttled_flags'] is not None and last['throttled_flags'] is not None:
+            if (last['throttled_flags'] & ~first['throttled_flags']) & self.PI_THROTTLED_SINCE_BOOT:
+                return True
+
+        return False
+
+    def to_dict(self) -> Dict[str, Any]:
+        return {
+            'before': self._samples[0],
+            'during': self._samples[1:-1],
+            'after': self._samples[-1],
+            'throttled': self.throttled,
+        }
 
 
 class KoalaPerformanceTestCase(unittest.TestCase):
     AUDIO_PATH = os.path.join(os.path.dirname(__file__), '../../resources/audio_samples/test.wav')
+    STREAM_CHUNK_LENGTH = 4096
 
     access_key: str
     num_test_iterations: int
     proc_performance_threshold_sec: float
+    json_path: Optional[str] = None
+    results: Dict[str, Any] = dict()
 
-    def test_performance_proc(self) -> None:
+    @classmethod
+    def tearDownClass(cls) -> None:
+        if cls.json_path is not None:
+            with open(cls.json_path, 'w') as f:
+                json.dump(cls.results, f, indent=2)
+
+    def _load_pcm(self) -> Sequence[int]:
         with wave.open(self.AUDIO_PATH, 'rb') as f:
             buffer = f.readframes(f.getnframes())
-            pcm = struct.unpack('%dh' % (len(buffer) / struct.calcsize('h')), buffer)
+            return struct.unpack('%dh' % (len(buffer) / struct.calcsize('h')), buffer)
 
-        koala = Koala(
+    def _create_koala(self) -> Koala:
+        return Koala(
             access_key=self.access_key,
             library_path=default_library_path('../..'),
             model_path=default_model_path('../..'))
 
+    @staticmethod
+    def _warn_if_throttled(machine_state: MachineStateSampler) -> None:
+        if machine_state.throttled:
+            print("WARNING: the CPU was throttled during the run, so the result is not comparable to unthrottled runs")
+
+    def test_performance_proc(self) -> None:
+        pcm = self._load_pcm()
+        koala = self._create_koala()
+
         num_frames = len(pcm) // koala.frame_length
 
         perf_results = list()
-        for i in range(self.num_test_iterations + 1):
-            start = perf_counter()
-            for j in range(num_frames):
-                frame = pcm[j * koala.frame_length:(j + 1) * koala.frame_length]
-                koala.process(frame)
+        with MachineStateSampler() as machine_state:
+            for i in range(self.num_test_iterations + 1):
+                start = perf_counter()
+                for j in range(num_frames):
+                    frame = pcm[j * koala.frame_length:(j + 1) * koala.frame_length]
+                    koala.process(frame)
 
-            if i > 0:
-                perf_results.append(perf_counter() - start)
+                if i > 0:
+                    perf_results.append(perf_counter() - start)
 
         koala.delete()
 
         avg_perf = sum(perf_results) / self.num_test_iterations
         print("Average proc performance: %s seconds" % avg_perf)
+        self._warn_if_throttled(machine_state)
+
+        self.results.update({
+            'num_test_iterations': self.num_test_iterations,
+            'proc_performance_sec': perf_results,
+            'average_proc_performance_sec': avg_perf,
+            'machine_state': machine_state.to_dict(),
+        })
+
         self.assertLess(avg_perf, self.proc_performance_threshold_sec)
 
+    def _time_per_frame_usec(self, runs: Dict[str, Callable[[], int]]) -> Dict[str, float]:
+        # Each run makes one pass over the recording and returns the number of frames it went through. Passes of
+        # different runs are interleaved so that drifting clock speeds affect all of them alike, and the first pass of
+        # each is a warm-up.
+        elapsed_sec = {name: 0. for name in runs}
+        num_frames = {name: 0 for name in runs}
+        for i in range(self.num_test_iterations + 1):
+            for name, run in runs.items():
+                start = perf_counter()
+                num_run_frames = run()
+                if i > 0:
+                    elapsed_sec[name] += perf_counter() - start
+                    num_frames[name] += num_run_frames
+
+        return {name: elapsed_sec[name] * 1e6 / num_frames[name] for name in runs}
+
+    def test_performance_binding_overhead(self) -> None:
+        pcm = self._load_pcm()
+        koala = self._create_koala()
+
+        frame_length = koala.frame_length
+        num_frames = len(pcm) // frame_length
+        frames = [pcm[i * frame_length:(i + 1) * frame_length] for i in range(num_frames)]
+        array_frames = [array.array('h', frame) for frame in frames]
+        native_frames = [(c_short * frame_length)(*frame) for frame in frames]
+        enhanced_frame = array.array('h', [0] * frame_length)
+        native_frame = (c_short * frame_length)()
+        native_enhanced_frame = (c_short * frame_length)()
+
+        array_pcm = array.array('h', pcm)
+        enhanced_pcm = array.array('h', [0] * len(pcm))
+        num_batch_frames = (len(pcm) + koala.delay_sample + frame_length - 1) // frame_length
+        stream = KoalaStream(koala)
+
+        # The bare library call is the baseline; whatever the other paths take on top of it is spent in the binding.
+        def run_native() -> int:
+            for frame in native_frames:
+                koala._process_func(koala._handle, frame, native_enhanced_frame)
+            return num_frames
+
+        # The steps `.process()` takes around the library call, each on its own: slicing a frame out of the
+        # recording, copying it into a `ctypes` array and copying the enhanced frame back out into a list.
+        def run_tuple_slicing() -> int:
+            for i in range(num_frames):
+                pcm[i * frame_length:(i + 1) * frame_length]
+            return num_frames
+
+        def run_ctypes_conversion() -> int:
+            for frame in frames:
+                native_frame[:] = frame
+            return num_frames
+
+        def run_list_conversion() -> int:
+            for _ in range(num_frames):
+                native_enhanced_frame[:]
+            return num_frames
+
+        def run_process() -> int:
+            for frame in frames:
+                koala.process(frame)
+            return num_frames
+
+        def run_process_into() -> int:
+            for frame in array_frames:
+                koala.process_into(frame, enhanced_frame)
+            return num_frames
+
+        def run_process_buffer() -> int:
+            koala.process_buffer(array_pcm, enhanced_pcm)
+            return num_batch_frames
+
+        def run_stream() -> int:
+            view = memoryview(array_pcm)
+            for start in range(0, len(view), self.STREAM_CHUNK_LENGTH):
+                stream.process(view[start:start + self.STREAM_CHUNK_LENGTH])
+            stream.close()
+            return num_batch_frames
+
+        runs = {
+            'native': run_native,
+            'tuple_slicing': run_tuple_slicing,
+            'ctypes_conversion': run_ctypes_conversion,
+            'list_conversion': run_list_conversion,
+            'process': run_process,
+            'process_into': run_process_into,
+            'process_buffer': run_process_buffer,
+            'stream': run_stream,
+        }
+
+        try:
+            import numpy
+        except ImportError:
+            numpy = None
+        if numpy is not None:
+            numpy_pcm = numpy.array(pcm, dtype=numpy.int16)
+            numpy_frames = [numpy_pcm[i * frame_length:(i + 1) * frame_length] for i in range(num_frames)]
+            numpy_enhanced_frame = numpy.zeros(frame_length, dtype=numpy.int16)
+            numpy_enhanced_pcm = numpy.zeros(len(pcm), dtype=numpy.int16)
+
+            def run_process_into_numpy() -> int:
+                for frame in numpy_frames:
+                    koala.process_into(frame, numpy_enhanced_frame)
+                return num_frames
+
+            def run_process_buffer_numpy() -> int:
+                koala.process_buffer(numpy_pcm, numpy_enhanced_pcm)
+                return num_batch_frames
+
+            runs['process_into_numpy'] = run_process_into_numpy
+            runs['process_buffer_numpy'] = run_process_buffer_numpy
+        else:
+            print("NumPy is not installed, skipping the NumPy paths")
+
+        with MachineStateSampler() as machine_state:
+            per_frame_usec = self._time_per_frame_usec(runs)
+
+        koala.delete()
+
+        paths = [name for name in runs if name.startswith('process') or name == 'stream']
+        overhead_usec = {name: per_frame_usec[name] - per_frame_usec['native'] for name in paths}
+
+        print("Time per frame (usec), and overhead over the native call:")
+        for name, usec in per_frame_usec.items():
+            if name in overhead_usec:
+                print("  %-22s %9.2f %+9.2f" % (name, usec, overhead_usec[name]))
+            else:
+                print("  %-22s %9.2f" % (name, usec))
+
+        self._warn_if_throttled(machine_state)
+
+        self.results['per_frame_usec'] = per_frame_usec
+        self.results['binding_overhead_usec'] = overhead_usec
+        self.results['binding_overhead_machine_state'] = machine_state.to_dict()
+
+        self.assertLess(overhead_usec['process_into'], overhead_usec['process'])
+        self.assertLess(overhead_usec['process_buffer'], overhead_usec['process'])
+
+    def test_performance_multithreaded(self) -> None:
+        pcm = array.array('h', self._load_pcm())
+        max_num_threads = os.cpu_count() or 1
+        thread_counts = sorted({1, min(2, max_num_threads), max_num_threads})
+
+        results = list()
+        for num_threads in thread_counts:
+            instances = [self._create_koala() for _ in range(num_threads)]
+            try:
+                for koala in instances:
+                    koala.process_buffer(pcm)
+
+                def run(koala: Koala) -> None:
+                    enhanced_pcm = array.array('h', [0] * len(pcm))
+                    for _ in range(self.num_test_iterations):
+                        koala.process_buffer(pcm, enhanced_pcm)
+
+                with MachineStateSampler() as machine_state, ThreadPoolExecutor(max_workers=num_threads) as executor:
+                    start = perf_counter()
+                    list(executor.map(run, instances))
+                    elapsed_sec = perf_counter() - start
+
+                frame_length = instances[0].frame_length
+                num_frames = (len(pcm) + instances[0].delay_sample + frame_length - 1) // frame_length
+            finally:
+                for koala in instances:
+                    koala.delete()
+
+            frames_per_sec = num_threads * self.num_test_iterations * num_frames / elapsed_sec
+            results.append({
+                'num_threads': num_threads,
+                'frames_per_sec': frames_per_sec,
+                'speedup': frames_per_sec / results[0]['frames_per_sec'] if len(results) > 0 else 1.,
+                'machine_state': machine_state.to_dict(),
+            })
+            print("%d thread(s): %.0f frames/sec, %.2fx" % (num_threads, frames_per_sec, results[-1]['speedup']))
+            self._warn_if_throttled(machine_state)
+
+        self.results['multithreaded'] = results
+
+        for result in results:
+            self.assertGreater(result['frames_per_sec'], 0.)
+
 
 if __name__ == '__main__':
     parser = argparse.ArgumentParser()
     parser.add_argument('--access-key', required=True)
     parser.add_argument('--num-test-iterations', type=int, required=True)
     parser.add_argument('--proc-performance-threshold-sec', type=float, required=True)
+    parser.add_argument('--json-path', help='Writes the results and the machine state during the run to this file')
     args = parser.parse_args()
 
     KoalaPerformanceTestCase.access_key = args.access_key
     KoalaPerformanceTestCase.num_test_iterations = args.num_test_iterations
     KoalaPerformanceTestCase.proc_performance_threshold_sec = args.proc_performance_threshold_sec
+    KoalaPerformanceTestCase.json_path = args.json_path
 
     unittest.main(argv=sys.argv[:1])
@@ -0,0 +1,344 @@
+/*
+    Copyright 2023 Picovoice Inc.
+
+    You may not use this file except in compliance with the license. A copy of the license is located in the "LICENSE"
+    file accompanying this source.
+
+    Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+    an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the
+    specific language governing permissions and limitations under the License.
+*/
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+
+#include <windows.h>
+
+#else
+
+#include <dlfcn.h>
+#include <time.h>
+
+#endif
+
+#define DR_WAV_IMPLEMENTATION
+
+#include "dr_wav.h"
+
+#include "pv_koala.h"
+
+static void *open_dl(const char *dl_path) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    return LoadLibrary(dl_path);
+
+#else
+
+    return dlopen(dl_path, RTLD_NOW);
+
+#endif
+}
+
+static void *load_symbol(void *handle, const char *symbol) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    return GetProcAddress((HMODULE) handle, symbol);
+
+#else
+
+    return dlsym(handle, symbol);
+
+#endif
+}
+
+static void close_dl(void *handle) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    FreeLibrary((HMODULE) handle);
+
+#else
+
+    dlclose(handle);
+
+#endif
+}
+
+static void print_dl_error(const char *message) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    fprintf(stderr, "%s with code '%lu'.\n", message, GetLastError());
+
+#else
+
+    fprintf(stderr, "%s with '%s'.\n", message, dlerror());
+
+#endif
+}
+
+static double get_time_usec(void) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    static LARGE_INTEGER frequency = {0};
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (double) counter.QuadPart * 1e6 / (double) frequency.QuadPart;
+
+#else
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec * 1e6 + (double) now.tv_nsec * 1e-3;
+
+#endif
+}
+
+static struct option long_options[] = {
+        {"access_key",     required_argument, NULL, 'a'},
+        {"library_path",   required_argument, NULL, 'l'},
+        {"model_path",     required_argument, NULL, 'm'},
+        {"input_path",     required_argument, NULL, 'i'},
+        {"json_path",      required_argument, NULL, 'j'},
+        {"num_iterations", required_argument, NULL, 'n'},
+        {NULL,             0,                 NULL, 0},
+};
+
+void print_usage(const char *program_name) {
+    fprintf(stdout,
+            "Usage: %s [-l LIBRARY_PATH -m MODEL_PATH -a ACCESS_KEY -i INPUT_PATH -j JSON_PATH -n NUM_ITERATIONS]\n",
+            program_name);
+}
+
+int picovoice_main(int argc, char *argv[]) {
+    const char *library_path = NULL;
+    const char *model_path = NULL;
+    const char *access_key = NULL;
+    const char *input_path = NULL;
+    const char *json_path = NULL;
+    int32_t num_iterations = 10;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "l:m:a:i:j:n:", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'l':
+                library_path = optarg;
+                break;
+            case 'm':
+                model_path = optarg;
+                break;
+            case 'a':
+                access_key = optarg;
+                break;
+            case 'i':
+                input_path = optarg;
+                break;
+            case 'j':
+                json_path = optarg;
+                break;
+            case 'n':
+                num_iterations = (int32_t) strtol(optarg, NULL, 10);
+                break;
+            default:
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    if (!library_path || !access_key || !input_path || (num_iterations < 1)) {
+        print_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    // The input is read before the library is opened so that file I/O is not attributed to any of the startup stages.
+    drwav input_file;
+    if (!drwav_init_file(&input_file, input_path, NULL)) {
+        fprintf(stderr, "failed to open wav file at '%s'.\n", input_path);
+        exit(EXIT_FAILURE);
+    }
+
+    if ((input_file.bitsPerSample != 16) || (input_file.channels != 1)) {
+        fprintf(stderr, "audio should be single-channel with 16-bit PCM encoding.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    const size_t num_samples = (size_t) input_file.totalPCMFrameCount;
+    int16_t *input_pcm = (int16_t *) malloc(num_samples * sizeof(int16_t));
+    if (!input_pcm) {
+        fprintf(stderr, "failed to allocate input memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (drwav_read_pcm_frames_s16(&input_file, num_samples, input_pcm) != num_samples) {
+        fprintf(stderr, "failed to read from '%s'.\n", input_path);
+        exit(EXIT_FAILURE);
+    }
+    const uint32_t input_sample_rate = input_file.sampleRate;
+    drwav_uninit(&input_file);
+
+    const double before_dl_usec = get_time_usec();
+
+    void *koala_library = open_dl(library_path);
+    if (!koala_library) {
+        fprintf(stderr, "failed to open library at '%s'.\n", library_path);
+        exit(EXIT_FAILURE);
+    }
+
+    const double after_dl_usec = get_time_usec();
+
+    const char *(*pv_status_to_string_func)(pv_status_t) = load_symbol(koala_library, "pv_status_to_string");
+    if (!pv_status_to_string_func) {
+        print_dl_error("failed to load 'pv_status_to_string'");
+        exit(EXIT_FAILURE);
+    }
+
+    int32_t (*pv_sample_rate_func)() = load_symbol(koala_library, "pv_sample_rate");
+    if (!pv_sample_rate_func) {
+        print_dl_error("failed to load 'pv_sample_rate'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_status_t (*pv_koala_init_func)(const char *, const char *, pv_koala_t **) =
+            load_symbol(koala_library, "pv_koala_init");
+    if (!pv_koala_init_func) {
+        print_dl_error("failed to load 'pv_koala_init'");
+        exit(EXIT_FAILURE);
+    }
+
+    void (*pv_koala_delete_func)(pv_koala_t *) = load_symbol(koala_library, "pv_koala_delete");
+    if (!pv_koala_delete_func) {
+        print_dl_error("failed to load 'pv_koala_delete'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_status_t (*pv_koala_process_func)(pv_koala_t *, const int16_t *, int16_t *) =
+            load_symbol(koala_library, "pv_koala_process");
+    if (!pv_koala_process_func) {
+        print_dl_error("failed to load 'pv_koala_process'");
+        exit(EXIT_FAILURE);
+    }
+
+    int32_t (*pv_koala_frame_length_func)() = load_symbol(koala_library, "pv_koala_frame_length");
+    if (!pv_koala_frame_length_func) {
+        print_dl_error("failed to load 'pv_koala_frame_length'");
+        exit(EXIT_FAILURE);
+    }
+
+    const char *(*pv_koala_version_func)() = load_symbol(koala_library, "pv_koala_version");
+    if (!pv_koala_version_func) {
+        print_dl_error("failed to load 'pv_koala_version'");
+        exit(EXIT_FAILURE);
+    }
+
+    const double before_init_usec = get_time_usec();
+
+    pv_koala_t *koala = NULL;
+    pv_status_t koala_status = pv_koala_init_func(access_key, model_path, &koala);
+    if (koala_status != PV_STATUS_SUCCESS) {
+        fprintf(stderr, "failed to init with '%s'.\n", pv_status_to_string_func(koala_status));
+        exit(EXIT_FAILURE);
+    }
+
+    const double after_init_usec = get_time_usec();
+
+    if (input_sample_rate != (uint32_t) pv_sample_rate_func()) {
+        fprintf(stderr, "audio sample rate should be %d.\n", pv_sample_rate_func());
+        exit(EXIT_FAILURE);
+    }
+
+    const int32_t frame_length = pv_koala_frame_length_func();
+    const int32_t num_frames = (int32_t) (num_samples / frame_length);
+    if (num_frames < 2) {
+        fprintf(stderr, "input should contain at least two frames of audio.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int16_t *enhanced_pcm = (int16_t *) malloc(frame_length * sizeof(int16_t));
+    if (!enhanced_pcm) {
+        fprintf(stderr, "failed to allocate enhanced_pcm memory.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    const double before_first_frame_usec = get_time_usec();
+
+    koala_status = pv_koala_process_func(koala, input_pcm, enhanced_pcm);
+    if (koala_status != PV_STATUS_SUCCESS) {
+        fprintf(stderr, "'pv_koala_process' failed with '%s'.\n", pv_status_to_string_func(koala_status));
+        exit(EXIT_FAILURE);
+    }
+
+    const double after_first_frame_usec = get_time_usec();
+
+    // Steady state starts at the second frame. Later iterations feed the file again without resetting, which keeps
+    // the instance in its warmed-up state.
+    const double before_steady_usec = get_time_usec();
+    int64_t num_steady_frames = 0;
+    for (int32_t i = 0; i < num_iterations; i++) {
+        for (int32_t j = (i == 0) ? 1 : 0; j < num_frames; j++) {
+            koala_status = pv_koala_process_func(koala, &input_pcm[j * frame_length], enhanced_pcm);
+            if (koala_status != PV_STATUS_SUCCESS) {
+                fprintf(stderr, "'pv_koala_process' failed with '%s'.\n", pv_status_to_string_func(koala_status));
+                exit(EXIT_FAILURE);
+            }
+            num_steady_frames++;
+        }
+    }
+    const double after_steady_usec = get_time_usec();
+
+    const double dl_open_usec = after_dl_usec - before_dl_usec;
+    const double init_usec = after_init_usec - before_init_usec;
+    const double first_frame_usec = after_first_frame_usec - before_first_frame_usec;
+    const double steady_frame_usec = (after_steady_usec - before_steady_usec) / (double) num_steady_frames;
+    // Covers everything a service does before its first enhanced frame: opening the library, resolving symbols,
+    // initializing the engine and processing one frame. Reading the input file is excluded.
+    const double time_to_first_frame_usec = after_first_frame_usec - before_dl_usec;
+    const double frame_duration_usec = (frame_length * 1e6) / pv_sample_rate_func();
+
+    fprintf(stdout, "V%s\n\n", pv_koala_version_func());
+    fprintf(stdout, "dlopen              : %10.3f ms\n", dl_open_usec * 1e-3);
+    fprintf(stdout, "pv_koala_init       : %10.3f ms\n", init_usec * 1e-3);
+    fprintf(stdout, "first frame         : %10.3f ms\n", first_frame_usec * 1e-3);
+    fprintf(stdout, "steady-state frame  : %10.3f ms (%" PRId64 " frames)\n", steady_frame_usec * 1e-3, num_steady_frames);
+    fprintf(stdout, "time to first frame : %10.3f ms\n", time_to_first_frame_usec * 1e-3);
+    fprintf(stdout, "real time factor    : %10.3f\n", steady_frame_usec / frame_duration_usec);
+
+    if (json_path) {
+        FILE *json_file = fopen(json_path, "w");
+        if (!json_file) {
+            fprintf(stderr, "failed to open json file at '%s'.\n", json_path);
+            exit(EXIT_FAILURE);
+        }
+        fprintf(json_file, "{\n");
+        fprintf(json_file, "  \"version\": \"%s\",\n", pv_koala_version_func());
+        fprintf(json_file, "  \"frame_length\": %d,\n", frame_length);
+        fprintf(json_file, "  \"sample_rate\": %d,\n", pv_sample_rate_func());
+        fprintf(json_file, "  \"dl_open_usec\": %.3f,\n", dl_open_usec);
+        fprintf(json_file, "  \"init_usec\": %.3f,\n", init_usec);
+        fprintf(json_file, "  \"first_frame_usec\": %.3f,\n", first_frame_usec);
+        fprintf(json_file, "  \"steady_frame_usec\": %.3f,\n", steady_frame_usec);
+        fprintf(json_file, "  \"num_steady_frames\": %" PRId64 ",\n", num_steady_frames);
+        fprintf(json_file, "  \"time_to_first_frame_usec\": %.3f,\n", time_to_first_frame_usec);
+        fprintf(json_file, "  \"real_time_factor\": %.6f\n", steady_frame_usec / frame_duration_usec);
+        fprintf(json_file, "}\n");
+        fclose(json_file);
+    }
+
+    free(enhanced_pcm);
+    free(input_pcm);
+    pv_koala_delete_func(koala);
+    close_dl(koala_library);
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+    return picovoice_main(argc, argv);
+}
@@ -0,0 +1,719 @@
+/*
+    Copyright 2023 Picovoice Inc.
+
+    You may not use this file except in compliance with the license. A copy of the license is located in the "LICENSE"
+    file accompanying this source.
+
+    Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+    an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the
+    specific language governing permissions and limitations under the License.
+*/
+
+#if defined(_WIN32) || defined(_WIN64)
+
+// `CreateWaitableTimerExW` is only declared for Windows Vista and later. Defined ahead of every include, since any of
+// them may pull in the Windows version headers.
+#if !defined(_WIN32_WINNT) || (_WIN32_WINNT < 0x0600)
+#undef _WIN32_WINNT
+#define _WIN32_WINNT (0x0600)
+#endif
+
+#endif
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+
+#include <windows.h>
+
+#else
+
+#include <dlfcn.h>
+#include <time.h>
+#include <unistd.h>
+
+#endif
+
+#define DR_WAV_IMPLEMENTATION
+
+#include "dr_wav.h"
+
+#include "pv_koala.h"
+
+#include "koala_latency_histogram.h"
+
+static void *open_dl(const char *dl_path) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    return LoadLibrary(dl_path);
+
+#else
+
+    return dlopen(dl_path, RTLD_NOW);
+
+#endif
+
+}
+
+static void *load_symbol(void *handle, const char *symbol) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    return GetProcAddress((HMODULE) handle, symbol);
+
+#else
+
+    return dlsym(handle, symbol);
+
+#endif
+
+}
+
+static void close_dl(void *handle) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    FreeLibrary((HMODULE) handle);
+
+#else
+
+    dlclose(handle);
+
+#endif
+
+}
+
+static void print_dl_error(const char *message) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    fprintf(stderr, "%s with code '%lu'.\n", message, GetLastError());
+
+#else
+
+    fprintf(stderr, "%s with '%s'.\n", message, dlerror());
+
+#endif
+
+}
+
+static double get_time_usec(void) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    static LARGE_INTEGER frequency = {0};
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (double) counter.QuadPart * 1e6 / (double) frequency.QuadPart;
+
+#else
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec * 1e6 + (double) now.tv_nsec * 1e-3;
+
+#endif
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION (0x00000002)
+#endif
+
+// Even a high-resolution timer can wake up a few hundred microseconds late, so the last part of every wait is spun.
+#define SPIN_USEC (500.)
+
+#endif
+
+/**
+ * Returns a timer for `sleep_until_usec`, to be owned by a single thread. `Sleep()` only wakes up on the ~15.6 ms
+ * scheduler tick, far coarser than a frame, so on Windows this is a high-resolution waitable timer. The benchmark
+ * refuses to run where one is not available (before Windows 10, version 1803).
+ */
+static void *open_sleep_timer(void) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    HANDLE timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!timer) {
+        fprintf(stderr, "failed to create a high-resolution timer with code '%lu'.\n", GetLastError());
+        exit(EXIT_FAILURE);
+    }
+    return timer;
+
+#else
+
+    return NULL;
+
+#endif
+
+}
+
+static void close_sleep_timer(void *timer) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    CloseHandle((HANDLE) timer);
+
+#else
+
+    (void) timer;
+
+#endif
+
+}
+
+static void sleep_until_usec(void *timer, double target_usec) {
+    const double remaining_usec = target_usec - get_time_usec();
+    if (remaining_usec <= 0) {
+        return;
+    }
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    if (remaining_usec > SPIN_USEC) {
+        LARGE_INTEGER due_time;
+        due_time.QuadPart = -(LONGLONG) ((remaining_usec - SPIN_USEC) * 10.);
+        if (SetWaitableTimer((HANDLE) timer, &due_time, 0, NULL, NULL, FALSE)) {
+            WaitForSingleObject((HANDLE) timer, INFINITE);
+        }
+    }
+    while (get_time_usec() < target_usec) {
+        YieldProcessor();
+    }
+
+#else
+
+    (void) timer;
+    struct timespec duration;
+    duration.tv_sec = (time_t) (remaining_usec * 1e-6);
+    duration.tv_nsec = (long) ((remaining_usec - (double) duration.tv_sec * 1e6) * 1e3);
+    nanosleep(&duration, NULL);
+
+#endif
+
+}
+
+static int32_t get_num_cpus(void) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int32_t) info.dwNumberOfProcessors;
+
+#else
+
+    const long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return (num_cpus > 0) ? (int32_t) num_cpus : 1;
+
+#endif
+
+}
+
+static const char *(*pv_status_to_string_func)(pv_status_t) = NULL;
+static int32_t (*pv_sample_rate_func)() = NULL;
+static pv_status_t (*pv_koala_init_func)(const char *, const char *, pv_koala_t **) = NULL;
+static void (*pv_koala_delete_func)(pv_koala_t *) = NULL;
+static pv_status_t (*pv_koala_process_func)(pv_koala_t *, const int16_t *, int16_t *) = NULL;
+static pv_status_t (*pv_koala_reset_func)(pv_koala_t *) = NULL;
+static int32_t (*pv_koala_frame_length_func)() = NULL;
+static const char *(*pv_koala_version_func)() = NULL;
+
+static struct option long_options[] = {
+        {"access_key",        required_argument, NULL, 'a'},
+        {"library_path",      required_argument, NULL, 'l'},
+        {"model_path",        required_argument, NULL, 'm'},
+        {"input_path",        required_argument, NULL, 'i'},
+        {"num_threads",       required_argument, NULL, 't'},
+        {"min_streams",       required_argument, NULL, 'n'},
+        {"max_streams",       required_argument, NULL, 'x'},
+        {"step",              required_argument, NULL, 's'},
+        {"seconds_per_level", required_argument, NULL, 'd'},
+        {"json_path",         required_argument, NULL, 'j'},
+        {NULL,                0,                 NULL, 0},
+};
+
+// Kept small because every stream holds an activated instance.
+#define DEFAULT_MAX_STREAMS (16)
+
+void print_usage(const char *program_name) {
+    fprintf(stdout,
+            "Usage: %s [-l LIBRARY_PATH -m MODEL_PATH -a ACCESS_KEY -i INPUT_PATH -t NUM_THREADS -n MIN_STREAMS "
+            "-x MAX_STREAMS -s STEP -d SECONDS_PER_LEVEL -j JSON_PATH]\n"
+            "Every stream initializes its own Koala instance with ACCESS_KEY, so a ramp up to MAX_STREAMS (default %d) "
+            "uses up to that many activations. Raise it with -x only on machines expected to sustain more streams.\n",
+            program_name,
+            DEFAULT_MAX_STREAMS);
+}
+
+/**
+ * A simulated real-time stream. Frame `k` of the stream becomes available at `start_usec + (k + 1) * frame_usec`, once
+ * all of its samples have been "captured", and must be enhanced before frame `k + 1` becomes available.
+ */
+typedef struct {
+    pv_koala_t *koala;
+    int16_t *enhanced_pcm;
+    int32_t input_frame_offset;
+    double start_usec;
+    uint64_t next_frame;
+    uint64_t num_missed;
+    double max_lateness_usec;
+} stream_t;
+
+typedef struct {
+    stream_t *streams;
+    int32_t num_streams;
+    int32_t num_threads;
+    const int16_t *input_pcm;
+    int32_t num_input_frames;
+    int32_t frame_length;
+    double frame_usec;
+    double end_usec;
+} load_t;
+
+typedef struct {
+    load_t *load;
+    int32_t thread_index;
+    koala_latency_histogram_t latency_histogram;
+} worker_t;
+
+/**
+ * Serves the streams at `thread_index`, `thread_index + num_threads`, ... in earliest-deadline-first order until the
+ * end of the level. A worker that falls behind keeps working through the backlog rather than skipping frames, the same
+ * way a buffered real-time service would, so every late frame is counted as a miss.
+ */
+static void *worker_thread(void *arg) {
+    worker_t *worker = (worker_t *) arg;
+    load_t *load = worker->load;
+    void *sleep_timer = open_sleep_timer();
+
+    while (true) {
+        stream_t *stream = NULL;
+        double available_usec = 0;
+        for (int32_t i = worker->thread_index; i < load->num_streams; i += load->num_threads) {
+            const stream_t *candidate = &load->streams[i];
+            const double t = candidate->start_usec + (double) (candidate->next_frame + 1) * load->frame_usec;
+            if (!stream || (t < available_usec)) {
+                stream = &load->streams[i];
+                available_usec = t;
+            }
+        }
+        if (!stream || (available_usec >= load->end_usec)) {
+            break;
+        }
+
+        sleep_until_usec(sleep_timer, available_usec);
+
+        const int32_t input_frame =
+                (int32_t) ((stream->input_frame_offset + stream->next_frame) % load->num_input_frames);
+        pv_status_t koala_status = pv_koala_process_func(
+                stream->koala,
+                &load->input_pcm[input_frame * load->frame_length],
+                stream->enhanced_pcm);
+        if (koala_status != PV_STATUS_SUCCESS) {
+            fprintf(stderr, "'pv_koala_process' failed with '%s'.\n", pv_status_to_string_func(koala_status));
+            exit(EXIT_FAILURE);
+        }
+
+        const double latency_usec = get_time_usec() - available_usec;
+        koala_latency_histogram_record(&worker->latency_histogram, (uint64_t) (latency_usec * 1e3));
+        if (latency_usec > load->frame_usec) {
+            stream->num_missed++;
+            if ((latency_usec - load->frame_usec) > stream->max_lateness_usec) {
+                stream->max_lateness_usec = latency_usec - load->frame_usec;
+            }
+        }
+        stream->next_frame++;
+    }
+
+    close_sleep_timer(sleep_timer);
+
+    return NULL;
+}
+
+typedef struct {
+    int32_t num_streams;
+    uint64_t num_frames;
+    uint64_t num_missed;
+    double worst_stream_miss_rate;
+    double max_lateness_usec;
+    uint64_t p50_latency_nsec;
+    uint64_t p99_latency_nsec;
+    uint64_t max_latency_nsec;
+    double *stream_miss_rates;
+} level_result_t;
+
+/**
+ * Runs `num_streams` streams for `seconds_per_level` seconds. Stream start times are spread over one frame so that the
+ * streams do not all become ready at the same instant.
+ */
+static void run_level(
+        load_t *load,
+        int32_t num_streams,
+        int32_t num_threads,
+        double seconds_per_level,
+        level_result_t *result) {
+    load->num_streams = num_streams;
+    load->num_threads = (num_threads < num_streams) ? num_threads : num_streams;
+
+    const double start_usec = get_time_usec() + 10e3;
+    for (int32_t i = 0; i < num_streams; i++) {
+        stream_t *stream = &load->streams[i];
+        pv_status_t koala_status = pv_koala_reset_func(stream->koala);
+        if (koala_status != PV_STATUS_SUCCESS) {
+            fprintf(stderr, "'pv_koala_reset' failed with '%s'.\n", pv_status_to_string_func(koala_status));
+            exit(EXIT_FAILURE);
+        }
+        stream->start_usec = start_usec + (load->frame_usec * i) / num_streams;
+        stream->next_frame = 0;
+        stream->num_missed = 0;
+        stream->max_lateness_usec = 0;
+    }
+    load->end_usec = start_usec + seconds_per_level * 1e6;
+
+    worker_t *workers = (worker_t *) calloc(load->num_threads, sizeof(worker_t));
+    pthread_t *threads = (pthread_t *) calloc(load->num_threads, sizeof(pthread_t));
+    if (!workers || !threads) {
+        fprintf(stderr, "failed to allocate memory for worker threads.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int32_t i = 0; i < load->num_threads; i++) {
+        workers[i].load = load;
+        workers[i].thread_index = i;
+        koala_latency_histogram_init(&workers[i].latency_histogram);
+        if (pthread_create(&threads[i], NULL, worker_thread, &workers[i]) != 0) {
+            fprintf(stderr, "failed to start worker thread.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    koala_latency_histogram_t latency_histogram;
+    koala_latency_histogram_init(&latency_histogram);
+    for (int32_t i = 0; i < load->num_threads; i++) {
+        pthread_join(threads[i], NULL);
+        koala_latency_histogram_merge(&latency_histogram, &workers[i].latency_histogram);
+    }
+    free(workers);
+    free(threads);
+
+    memset(result, 0, sizeof(*result));
+    result->num_streams = num_streams;
+    result->stream_miss_rates = (double *) calloc(num_streams, sizeof(double));
+    if (!result->stream_miss_rates) {
+        fprintf(stderr, "failed to allocate memory for results.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int32_t i = 0; i < num_streams; i++) {
+        const stream_t *stream = &load->streams[i];
+        result->num_frames += stream->next_frame;
+        result->num_missed += stream->num_missed;
+        result->stream_miss_rates[i] =
+                (stream->next_frame > 0) ? ((double) stream->num_missed / (double) stream->next_frame) : 0.;
+        if (result->stream_miss_rates[i] > result->worst_stream_miss_rate) {
+            result->worst_stream_miss_rate = result->stream_miss_rates[i];
+        }
+        if (stream->max_lateness_usec > result->max_lateness_usec) {
+            result->max_lateness_usec = stream->max_lateness_usec;
+        }
+    }
+    result->p50_latency_nsec = koala_latency_histogram_percentile(&latency_histogram, 50.);
+    result->p99_latency_nsec = koala_latency_histogram_percentile(&latency_histogram, 99.);
+    result->max_latency_nsec = latency_histogram.max_value;
+}
+
+int picovoice_main(int argc, char *argv[]) {
+    const char *library_path = NULL;
+    const char *model_path = NULL;
+    const char *access_key = NULL;
+    const char *input_path = NULL;
+    const char *json_path = NULL;
+    int32_t num_threads = get_num_cpus();
+    int32_t min_streams = 1;
+    int32_t max_streams = DEFAULT_MAX_STREAMS;
+    int32_t step = 1;
+    double seconds_per_level = 10.;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "l:m:a:i:t:n:x:s:d:j:", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'l':
+                library_path = optarg;
+                break;
+            case 'm':
+                model_path = optarg;
+                break;
+            case 'a':
+                access_key = optarg;
+                break;
+            case 'i':
+                input_path = optarg;
+                break;
+            case 't':
+                num_threads = (int32_t) strtol(optarg, NULL, 10);
+                break;
+            case 'n':
+                min_streams = (int32_t) strtol(optarg, NULL, 10);
+                break;
+            case 'x':
+                max_streams = (int32_t) strtol(optarg, NULL, 10);
+                break;
+            case 's':
+                step = (int32_t) strtol(optarg, NULL, 10);
+                break;
+            case 'd':
+                seconds_per_level = strtod(optarg, NULL);
+                break;
+            case 'j':
+                json_path = optarg;
+                break;
+            default:
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    if (!library_path || !access_key || !input_path || (num_threads < 1) || (min_streams < 1) ||
+        (max_streams < min_streams) || (step < 1) || (seconds_per_level <= 0)) {
+        print_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    drwav input_file;
+    if (!drwav_init_file(&input_file, input_path, NULL)) {
+        fprintf(stderr, "failed to open wav file at '%s'.\n", input_path);
+        exit(EXIT_FAILURE);
+    }
+
+    if ((input_file.bitsPerSample != 16) || (input_file.channels != 1)) {
+        fprintf(stderr, "audio should be single-channel with 16-bit PCM encoding.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    const size_t num_samples = (size_t) input_file.totalPCMFrameCount;
+    int16_t *input_pcm = (int16_t *) malloc(num_samples * sizeof(int16_t));
+    if (!input_pcm) {
+        fprintf(stderr, "failed to allocate input memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (drwav_read_pcm_frames_s16(&input_file, num_samples, input_pcm) != num_samples) {
+        fprintf(stderr, "failed to read from '%s'.\n", input_path);
+        exit(EXIT_FAILURE);
+    }
+    const uint32_t input_sample_rate = input_file.sampleRate;
+    drwav_uninit(&input_file);
+
+    void *koala_library = open_dl(library_path);
+    if (!koala_library) {
+        fprintf(stderr, "failed to open library at '%s'.\n", library_path);
+        exit(EXIT_FAILURE);
+    }
+
+    pv_status_to_string_func = load_symbol(koala_library, "pv_status_to_string");
+    if (!pv_status_to_string_func) {
+        print_dl_error("failed to load 'pv_status_to_string'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_sample_rate_func = load_symbol(koala_library, "pv_sample_rate");
+    if (!pv_sample_rate_func) {
+        print_dl_error("failed to load 'pv_sample_rate'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_init_func = load_symbol(koala_library, "pv_koala_init");
+    if (!pv_koala_init_func) {
+        print_dl_error("failed to load 'pv_koala_init'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_delete_func = load_symbol(koala_library, "pv_koala_delete");
+    if (!pv_koala_delete_func) {
+        print_dl_error("failed to load 'pv_koala_delete'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_process_func = load_symbol(koala_library, "pv_koala_process");
+    if (!pv_koala_process_func) {
+        print_dl_error("failed to load 'pv_koala_process'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_reset_func = load_symbol(koala_library, "pv_koala_reset");
+    if (!pv_koala_reset_func) {
+        print_dl_error("failed to load 'pv_koala_reset'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_frame_length_func = load_symbol(koala_library, "pv_koala_frame_length");
+    if (!pv_koala_frame_length_func) {
+        print_dl_error("failed to load 'pv_koala_frame_length'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_version_func = load_symbol(koala_library, "pv_koala_version");
+    if (!pv_koala_version_func) {
+        print_dl_error("failed to load 'pv_koala_version'");
+        exit(EXIT_FAILURE);
+    }
+
+    if (input_sample_rate != (uint32_t) pv_sample_rate_func()) {
+        fprintf(stderr, "audio sample rate should be %d.\n", pv_sample_rate_func());
+        exit(EXIT_FAILURE);
+    }
+
+    const int32_t frame_length = pv_koala_frame_length_func();
+    const int32_t num_input_frames = (int32_t) (num_samples / frame_length);
+    if (num_input_frames < 1) {
+        fprintf(stderr, "input should contain at least one frame of audio.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    load_t load;
+    memset(&load, 0, sizeof(load));
+    load.input_pcm = input_pcm;
+    load.num_input_frames = num_input_frames;
+    load.frame_length = frame_length;
+    load.frame_usec = (frame_length * 1e6) / pv_sample_rate_func();
+    load.streams = (stream_t *) calloc(max_streams, sizeof(stream_t));
+    if (!load.streams) {
+        fprintf(stderr, "failed to allocate memory for streams.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    const int32_t max_num_levels = ((max_streams - min_streams) / step) + 1;
+    level_result_t *results = (level_result_t *) calloc(max_num_levels, sizeof(level_result_t));
+    if (!results) {
+        fprintf(stderr, "failed to allocate memory for results.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    fprintf(stdout, "V%s\n\n", pv_koala_version_func());
+    fprintf(stdout,
+            "Ramping from %d to %d streams in steps of %d, %.1f seconds per level, on %d threads...\n\n",
+            min_streams,
+            max_streams,
+            step,
+            seconds_per_level,
+            num_threads);
+    fprintf(stdout, "streams |   frames |  missed | worst stream miss rate | p50 ms | p99 ms | max ms\n");
+
+    // Instances are created as the load grows and reused by later levels, so that initialization never overlaps a
+    // measurement.
+    int32_t num_instances = 0;
+    int32_t num_levels = 0;
+    int32_t max_sustainable_streams = 0;
+    bool ceiling_reached = true;
+    for (int32_t num_streams = min_streams; num_streams <= max_streams; num_streams += step) {
+        for (; num_instances < num_streams; num_instances++) {
+            stream_t *stream = &load.streams[num_instances];
+            pv_status_t koala_status = pv_koala_init_func(access_key, model_path, &stream->koala);
+            if (koala_status != PV_STATUS_SUCCESS) {
+                fprintf(stderr, "failed to init with '%s'.\n", pv_status_to_string_func(koala_status));
+                exit(EXIT_FAILURE);
+            }
+            stream->enhanced_pcm = (int16_t *) malloc(frame_length * sizeof(int16_t));
+            if (!stream->enhanced_pcm) {
+                fprintf(stderr, "failed to allocate enhanced_pcm memory.\n");
+                exit(EXIT_FAILURE);
+            }
+            stream->input_frame_offset = (int32_t) (((int64_t) num_instances * 7919) % num_input_frames);
+        }
+
+        level_result_t *result = &results[num_levels++];
+        run_level(&load, num_streams, num_threads, seconds_per_level, result);
+        fprintf(stdout,
+                "%7d | %8" PRIu64 " | %7" PRIu64 " | %21.2f%% | %6.2f | %6.2f | %6.2f\n",
+                num_streams,
+                result->num_frames,
+                result->num_missed,
+                result->worst_stream_miss_rate * 100.,
+                (double) result->p50_latency_nsec * 1e-6,
+                (double) result->p99_latency_nsec * 1e-6,
+                (double) result->max_latency_nsec * 1e-6);
+        fflush(stdout);
+
+        if (result->num_missed > 0) {
+            ceiling_reached = false;
+            break;
+        }
+        max_sustainable_streams = num_streams;
+    }
+
+    // Without a miss, the ramp only shows that the machine sustains the last level it ran, not where its limit is.
+    if (ceiling_reached) {
+        fprintf(stdout, "\nmax sustainable streams : >= %d (ceiling reached, raise -x)\n", max_sustainable_streams);
+    } else {
+        fprintf(stdout, "\nmax sustainable streams : %d\n", max_sustainable_streams);
+    }
+
+    const level_result_t *last_result = &results[num_levels - 1];
+    if (last_result->num_missed > 0) {
+        fprintf(stdout, "deadline miss rate per stream at %d streams :\n", last_result->num_streams);
+        for (int32_t i = 0; i < last_result->num_streams; i++) {
+            fprintf(stdout, "  stream %3d : %6.2f%%\n", i, last_result->stream_miss_rates[i] * 100.);
+        }
+    }
+
+    if (json_path) {
+        FILE *json_file = fopen(json_path, "w");
+        if (!json_file) {
+            fprintf(stderr, "failed to open json file at '%s'.\n", json_path);
+            exit(EXIT_FAILURE);
+        }
+        fprintf(json_file, "{\n");
+        fprintf(json_file, "  \"version\": \"%s\",\n", pv_koala_version_func());
+        fprintf(json_file, "  \"num_threads\": %d,\n", num_threads);
+        fprintf(json_file, "  \"seconds_per_level\": %.3f,\n", seconds_per_level);
+        fprintf(json_file, "  \"max_sustainable_streams\": %d,\n", max_sustainable_streams);
+        fprintf(json_file, "  \"ceiling_reached\": %s,\n", ceiling_reached ? "true" : "false");
+        fprintf(json_file, "  \"levels\": [");
+        for (int32_t i = 0; i < num_levels; i++) {
+            const level_result_t *result = &results[i];
+            fprintf(json_file, "%s\n    {\n", (i == 0) ? "" : ",");
+            fprintf(json_file, "      \"num_streams\": %d,\n", result->num_streams);
+            fprintf(json_file, "      \"num_frames\": %" PRIu64 ",\n", result->num_frames);
+            fprintf(json_file, "      \"num_missed\": %" PRIu64 ",\n", result->num_missed);
+            fprintf(json_file, "      \"max_lateness_usec\": %.3f,\n", result->max_lateness_usec);
+            fprintf(json_file, "      \"p50_latency_usec\": %.3f,\n", (double) result->p50_latency_nsec * 1e-3);
+            fprintf(json_file, "      \"p99_latency_usec\": %.3f,\n", (double) result->p99_latency_nsec * 1e-3);
+            fprintf(json_file, "      \"max_latency_usec\": %.3f,\n", (double) result->max_latency_nsec * 1e-3);
+            fprintf(json_file, "      \"stream_miss_rates\": [");
+            for (int32_t j = 0; j < result->num_streams; j++) {
+                fprintf(json_file, "%s%.6f", (j == 0) ? "" : ", ", result->stream_miss_rates[j]);
+            }
+            fprintf(json_file, "]\n    }");
+        }
+        fprintf(json_file, "\n  ]\n}\n");
+        fclose(json_file);
+    }
+
+    for (int32_t i = 0; i < num_levels; i++) {
+        free(results[i].stream_miss_rates);
+    }
+    free(results);
+    for (int32_t i = 0; i < num_instances; i++) {
+        pv_koala_delete_func(load.streams[i].koala);
+        free(load.streams[i].enhanced_pcm);
+    }
+    free(load.streams);
+    free(input_pcm);
+    close_dl(koala_library);
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+    return picovoice_main(argc, argv);
+}
@@ -0,0 +1,784 @@
+/*
+    Copyright 2023 Picovoice Inc.
+
+    You may not use this file except in compliance with the license. A copy of the license is located in the "LICENSE"
+    file accompanying this source.
+
+    Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+    an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the
+    specific language governing permissions and limitations under the License.
+*/
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+
+#include <windows.h>
+
+#else
+
+#include <dlfcn.h>
+#include <time.h>
+#include <unistd.h>
+
+#endif
+
+#if defined(__linux__)
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+#endif
+
+#define DR_WAV_IMPLEMENTATION
+
+#include "dr_wav.h"
+
+#include "pv_koala.h"
+
+#include "koala_machine_state.h"
+
+static void *open_dl(const char *dl_path) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    return LoadLibrary(dl_path);
+
+#else
+
+    return dlopen(dl_path, RTLD_NOW);
+
+#endif
+
+}
+
+static void *load_symbol(void *handle, const char *symbol) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    return GetProcAddress((HMODULE) handle, symbol);
+
+#else
+
+    return dlsym(handle, symbol);
+
+#endif
+
+}
+
+static void close_dl(void *handle) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    FreeLibrary((HMODULE) handle);
+
+#else
+
+    dlclose(handle);
+
+#endif
+
+}
+
+static void print_dl_error(const char *message) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    fprintf(stderr, "%s with code '%lu'.\n", message, GetLastError());
+
+#else
+
+    fprintf(stderr, "%s with '%s'.\n", message, dlerror());
+
+#endif
+
+}
+
+static double get_time_usec(void) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    static LARGE_INTEGER frequency = {0};
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (double) counter.QuadPart * 1e6 / (double) frequency.QuadPart;
+
+#else
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec * 1e6 + (double) now.tv_nsec * 1e-3;
+
+#endif
+}
+
+static void sleep_until_usec(double target_usec) {
+    const double remaining_usec = target_usec - get_time_usec();
+    if (remaining_usec <= 0) {
+        return;
+    }
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    Sleep((DWORD) (remaining_usec * 1e-3));
+
+#else
+
+    struct timespec duration;
+    duration.tv_sec = (time_t) (remaining_usec * 1e-6);
+    duration.tv_nsec = (long) ((remaining_usec - (double) duration.tv_sec * 1e6) * 1e3);
+    nanosleep(&duration, NULL);
+
+#endif
+
+}
+
+/**
+ * Hardware counters of the calling thread, read through `perf_event_open` on Linux. Only user-space events are
+ * counted so that the default `perf_event_paranoid` setting of most distributions allows them. Where the counters
+ * cannot be opened (other platforms, containers, virtual machines without a PMU) `is_available` stays `false` and the
+ * benchmark reports them as unavailable.
+ */
+typedef struct {
+    bool is_available;
+    int instructions_fd;
+    int cache_misses_fd;
+} perf_counters_t;
+
+#if defined(__linux__)
+
+static int open_perf_counter(uint64_t config, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = (group_fd == -1) ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int) syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+#endif
+
+static void perf_counters_open(perf_counters_t *counters) {
+    memset(counters, 0, sizeof(*counters));
+
+#if defined(__linux__)
+
+    counters->instructions_fd = open_perf_counter(PERF_COUNT_HW_INSTRUCTIONS, -1);
+    if (counters->instructions_fd < 0) {
+        return;
+    }
+    counters->cache_misses_fd = open_perf_counter(PERF_COUNT_HW_CACHE_MISSES, counters->instructions_fd);
+    if (counters->cache_misses_fd < 0) {
+        close(counters->instructions_fd);
+        return;
+    }
+    counters->is_available = true;
+
+#endif
+
+}
+
+static void perf_counters_start(perf_counters_t *counters) {
+
+#if defined(__linux__)
+
+    if (counters->is_available) {
+        ioctl(counters->instructions_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(counters->instructions_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+#else
+
+    (void) counters;
+
+#endif
+
+}
+
+static void perf_counters_stop(perf_counters_t *counters, uint64_t *instructions, uint64_t *cache_misses) {
+    *instructions = 0;
+    *cache_misses = 0;
+
+#if defined(__linux__)
+
+    if (counters->is_available) {
+        ioctl(counters->instructions_fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        uint64_t value = 0;
+        if (read(counters->instructions_fd, &value, sizeof(value)) == sizeof(value)) {
+            *instructions = value;
+        }
+        if (read(counters->cache_misses_fd, &value, sizeof(value)) == sizeof(value)) {
+            *cache_misses = value;
+        }
+    }
+
+#endif
+
+}
+
+static void perf_counters_close(perf_counters_t *counters) {
+
+#if defined(__linux__)
+
+    if (counters->is_available) {
+        close(counters->cache_misses_fd);
+        close(counters->instructions_fd);
+    }
+
+#endif
+
+    counters->is_available = false;
+}
+
+static const char *(*pv_status_to_string_func)(pv_status_t) = NULL;
+static int32_t (*pv_sample_rate_func)() = NULL;
+static pv_status_t (*pv_koala_init_func)(const char *, const char *, pv_koala_t **) = NULL;
+static void (*pv_koala_delete_func)(pv_koala_t *) = NULL;
+static pv_status_t (*pv_koala_process_func)(pv_koala_t *, const int16_t *, int16_t *) = NULL;
+static pv_status_t (*pv_koala_reset_func)(pv_koala_t *) = NULL;
+static int32_t (*pv_koala_frame_length_func)() = NULL;
+static const char *(*pv_koala_version_func)() = NULL;
+
+static struct option long_options[] = {
+        {"access_key",         required_argument, NULL, 'a'},
+        {"library_path",       required_argument, NULL, 'l'},
+        {"model_path",         required_argument, NULL, 'm'},
+        {"input_path",         required_argument, NULL, 'i'},
+        {"instances",          required_argument, NULL, 'I'},
+        {"threads",            required_argument, NULL, 'T'},
+        {"frames_per_call",    required_argument, NULL, 'F'},
+        {"seconds_per_config", required_argument, NULL, 'd'},
+        {"json_path",          required_argument, NULL, 'j'},
+        {NULL,                 0,                 NULL, 0},
+};
+
+void print_usage(const char *program_name) {
+    fprintf(stdout,
+            "Usage: %s [-l LIBRARY_PATH -m MODEL_PATH -a ACCESS_KEY -i INPUT_PATH -I INSTANCES -T THREADS "
+            "-F FRAMES_PER_CALL -d SECONDS_PER_CONFIG -j JSON_PATH]\n",
+            program_name);
+}
+
+#define MAX_SWEEP_VALUES (32)
+
+/**
+ * Parses a comma-separated list of positive integers such as `1,2,4,8`.
+ */
+static int32_t parse_sweep(const char *arg, int32_t *values) {
+    int32_t num_values = 0;
+    const char *p = arg;
+    while (*p != '\0') {
+        char *end = NULL;
+        const long value = strtol(p, &end, 10);
+        if ((end == p) || (value < 1) || (num_values == MAX_SWEEP_VALUES)) {
+            return -1;
+        }
+        values[num_values++] = (int32_t) value;
+        p = (*end == ',') ? (end + 1) : end;
+        if ((*end != ',') && (*end != '\0')) {
+            return -1;
+        }
+    }
+    return num_values;
+}
+
+typedef struct {
+    pv_koala_t **instances;
+    int16_t **enhanced_pcms;
+    int32_t num_instances;
+    int32_t num_threads;
+    int32_t frames_per_call;
+    const int16_t *input_pcm;
+    int32_t num_input_frames;
+    int32_t frame_length;
+    double duration_usec;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t start_cond;
+    int32_t num_ready_threads;
+    double start_usec;
+    double end_usec;
+} sweep_config_t;
+
+typedef struct {
+    sweep_config_t *config;
+    int32_t thread_index;
+    uint64_t num_frames;
+    double stop_usec;
+    bool has_counters;
+    uint64_t instructions;
+    uint64_t cache_misses;
+} worker_t;
+
+static void process_batch(const sweep_config_t *config, int32_t instance_index, uint64_t *input_frame) {
+    for (int32_t i = 0; i < config->frames_per_call; i++) {
+        const int32_t frame = (int32_t) ((*input_frame)++ % config->num_input_frames);
+        pv_status_t koala_status = pv_koala_process_func(
+                config->instances[instance_index],
+                &config->input_pcm[frame * config->frame_length],
+                config->enhanced_pcms[instance_index]);
+        if (koala_status != PV_STATUS_SUCCESS) {
+            fprintf(stderr, "'pv_koala_process' failed with '%s'.\n", pv_status_to_string_func(koala_status));
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+/**
+ * Blocks until every worker has finished its warm-up. The last one to arrive starts the clock, so warm-up time never
+ * counts as measured time however long it takes.
+ */
+static void wait_for_start(sweep_config_t *config, bool is_worker) {
+    pthread_mutex_lock(&config->mutex);
+    if (is_worker) {
+        config->num_ready_threads++;
+        if (config->num_ready_threads == config->num_threads) {
+            config->start_usec = get_time_usec();
+            config->end_usec = config->start_usec + config->duration_usec;
+            pthread_cond_broadcast(&config->start_cond);
+        }
+    }
+    while (config->num_ready_threads < config->num_threads) {
+        pthread_cond_wait(&config->start_cond, &config->mutex);
+    }
+    pthread_mutex_unlock(&config->mutex);
+}
+
+/**
+ * Owns the instances at `thread_index`, `thread_index + num_threads`, ... and cycles through them, feeding each
+ * `frames_per_call` consecutive frames at a time. Every owned instance gets one untimed batch first so that cold caches
+ * and lazy allocations inside the engine stay out of the measurement.
+ */
+static void *worker_thread(void *arg) {
+    worker_t *worker = (worker_t *) arg;
+    sweep_config_t *config = worker->config;
+
+    uint64_t input_frame = (uint64_t) worker->thread_index * 7919;
+    for (int32_t i = worker->thread_index; i < config->num_instances; i += config->num_threads) {
+        process_batch(config, i, &input_frame);
+    }
+
+    perf_counters_t counters;
+    perf_counters_open(&counters);
+    worker->has_counters = counters.is_available;
+
+    wait_for_start(config, true);
+    perf_counters_start(&counters);
+
+    uint64_t num_frames = 0;
+    while (get_time_usec() < config->end_usec) {
+        for (int32_t i = worker->thread_index; i < config->num_instances; i += config->num_threads) {
+            process_batch(config, i, &input_frame);
+            num_frames += config->frames_per_call;
+        }
+    }
+
+    worker->stop_usec = get_time_usec();
+    perf_counters_stop(&counters, &worker->instructions, &worker->cache_misses);
+    perf_counters_close(&counters);
+    worker->num_frames = num_frames;
+
+    return NULL;
+}
+
+typedef struct {
+    int32_t num_instances;
+    int32_t num_threads;
+    int32_t frames_per_call;
+    uint64_t num_frames;
+    double frames_per_sec;
+    double nsec_per_frame;
+    bool has_counters;
+    double instructions_per_frame;
+    double cache_misses_per_frame;
+    koala_machine_state_t machine_states[KOALA_MACHINE_STATE_MAX_SAMPLES];
+    int32_t num_machine_states;
+} sweep_result_t;
+
+static void run_config(sweep_config_t *config, double seconds_per_config, sweep_result_t *result) {
+    for (int32_t i = 0; i < config->num_instances; i++) {
+        pv_status_t koala_status = pv_koala_reset_func(config->instances[i]);
+        if (koala_status != PV_STATUS_SUCCESS) {
+            fprintf(stderr, "'pv_koala_reset' failed with '%s'.\n", pv_status_to_string_func(koala_status));
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    config->duration_usec = seconds_per_config * 1e6;
+    config->num_ready_threads = 0;
+    pthread_mutex_init(&config->mutex, NULL);
+    pthread_cond_init(&config->start_cond, NULL);
+
+    // The clock only starts once the workers are warm, so the first sample is placed on the timeline afterwards.
+    memset(result, 0, sizeof(*result));
+    const double before_usec = get_time_usec();
+    koala_machine_state_sample(&result->machine_states[result->num_machine_states++], 0.);
+
+    worker_t *workers = (worker_t *) calloc(config->num_threads, sizeof(worker_t));
+    pthread_t *threads = (pthread_t *) calloc(config->num_threads, sizeof(pthread_t));
+    if (!workers || !threads) {
+        fprintf(stderr, "failed to allocate memory for worker threads.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int32_t i = 0; i < config->num_threads; i++) {
+        workers[i].config = config;
+        workers[i].thread_index = i;
+        if (pthread_create(&threads[i], NULL, worker_thread, &workers[i]) != 0) {
+            fprintf(stderr, "failed to start worker thread.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    wait_for_start(config, false);
+    result->machine_states[0].elapsed_sec = (before_usec - config->start_usec) * 1e-6;
+
+    // The main thread samples the machine while the workers run, leaving room for the final sample after they stop.
+    const int32_t max_samples_during = KOALA_MACHINE_STATE_MAX_SAMPLES - 2;
+    double sample_interval_usec = seconds_per_config * 1e6 / max_samples_during;
+    if (sample_interval_usec < 500e3) {
+        sample_interval_usec = 500e3;
+    }
+    for (double sample_usec = config->start_usec + sample_interval_usec;
+         (sample_usec < config->end_usec) && (result->num_machine_states < (KOALA_MACHINE_STATE_MAX_SAMPLES - 1));
+         sample_usec += sample_interval_usec) {
+        sleep_until_usec(sample_usec);
+        koala_machine_state_sample(
+                &result->machine_states[result->num_machine_states++],
+                (get_time_usec() - config->start_usec) * 1e-6);
+    }
+
+    result->num_instances = config->num_instances;
+    result->num_threads = config->num_threads;
+    result->frames_per_call = config->frames_per_call;
+    result->has_counters = true;
+
+    double stop_usec = config->start_usec;
+    uint64_t instructions = 0;
+    uint64_t cache_misses = 0;
+    for (int32_t i = 0; i < config->num_threads; i++) {
+        pthread_join(threads[i], NULL);
+        result->num_frames += workers[i].num_frames;
+        result->has_counters = result->has_counters && workers[i].has_counters;
+        instructions += workers[i].instructions;
+        cache_misses += workers[i].cache_misses;
+        if (workers[i].stop_usec > stop_usec) {
+            stop_usec = workers[i].stop_usec;
+        }
+    }
+    free(workers);
+    free(threads);
+    pthread_cond_destroy(&config->start_cond);
+    pthread_mutex_destroy(&config->mutex);
+
+    koala_machine_state_sample(
+            &result->machine_states[result->num_machine_states++],
+            (get_time_usec() - config->start_usec) * 1e-6);
+
+    const double elapsed_sec = (stop_usec - config->start_usec) * 1e-6;
+    result->frames_per_sec = (elapsed_sec > 0) ? ((double) result->num_frames / elapsed_sec) : 0.;
+    // Time a thread spends on one frame, which unlike the inverse of the throughput is comparable across thread counts.
+    result->nsec_per_frame =
+            (result->num_frames > 0) ? (elapsed_sec * 1e9 * config->num_threads / (double) result->num_frames) : 0.;
+    if (result->has_counters && (result->num_frames > 0)) {
+        result->instructions_per_frame = (double) instructions / (double) result->num_frames;
+        result->cache_misses_per_frame = (double) cache_misses / (double) result->num_frames;
+    }
+}
+
+int picovoice_main(int argc, char *argv[]) {
+    const char *library_path = NULL;
+    const char *model_path = NULL;
+    const char *access_key = NULL;
+    const char *input_path = NULL;
+    const char *json_path = NULL;
+    int32_t instance_counts[MAX_SWEEP_VALUES] = {1, 2, 4};
+    int32_t num_instance_counts = 3;
+    int32_t thread_counts[MAX_SWEEP_VALUES] = {1, 2, 4};
+    int32_t num_thread_counts = 3;
+    int32_t frames_per_call_counts[MAX_SWEEP_VALUES] = {1, 16};
+    int32_t num_frames_per_call_counts = 2;
+    double seconds_per_config = 2.;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "l:m:a:i:I:T:F:d:j:", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'l':
+                library_path = optarg;
+                break;
+            case 'm':
+                model_path = optarg;
+                break;
+            case 'a':
+                access_key = optarg;
+                break;
+            case 'i':
+                input_path = optarg;
+                break;
+            case 'I':
+                num_instance_counts = parse_sweep(optarg, instance_counts);
+                break;
+            case 'T':
+                num_thread_counts = parse_sweep(optarg, thread_counts);
+                break;
+            case 'F':
+                num_frames_per_call_counts = parse_sweep(optarg, frames_per_call_counts);
+                break;
+            case 'd':
+                seconds_per_config = strtod(optarg, NULL);
+                break;
+            case 'j':
+                json_path = optarg;
+                break;
+            default:
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    if (!library_path || !access_key || !input_path || (num_instance_counts < 1) || (num_thread_counts < 1) ||
+        (num_frames_per_call_counts < 1) || (seconds_per_config <= 0)) {
+        print_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    drwav input_file;
+    if (!drwav_init_file(&input_file, input_path, NULL)) {
+        fprintf(stderr, "failed to open wav file at '%s'.\n", input_path);
+        exit(EXIT_FAILURE);
+    }
+
+    if ((input_file.bitsPerSample != 16) || (input_file.channels != 1)) {
+        fprintf(stderr, "audio should be single-channel with 16-bit PCM encoding.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    const size_t num_samples = (size_t) input_file.totalPCMFrameCount;
+    int16_t *input_pcm = (int16_t *) malloc(num_samples * sizeof(int16_t));
+    if (!input_pcm) {
+        fprintf(stderr, "failed to allocate input memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (drwav_read_pcm_frames_s16(&input_file, num_samples, input_pcm) != num_samples) {
+        fprintf(stderr, "failed to read from '%s'.\n", input_path);
+        exit(EXIT_FAILURE);
+    }
+    const uint32_t input_sample_rate = input_file.sampleRate;
+    drwav_uninit(&input_file);
+
+    void *koala_library = open_dl(library_path);
+    if (!koala_library) {
+        fprintf(stderr, "failed to open library at '%s'.\n", library_path);
+        exit(EXIT_FAILURE);
+    }
+
+    pv_status_to_string_func = load_symbol(koala_library, "pv_status_to_string");
+    if (!pv_status_to_string_func) {
+        print_dl_error("failed to load 'pv_status_to_string'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_sample_rate_func = load_symbol(koala_library, "pv_sample_rate");
+    if (!pv_sample_rate_func) {
+        print_dl_error("failed to load 'pv_sample_rate'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_init_func = load_symbol(koala_library, "pv_koala_init");
+    if (!pv_koala_init_func) {
+        print_dl_error("failed to load 'pv_koala_init'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_delete_func = load_symbol(koala_library, "pv_koala_delete");
+    if (!pv_koala_delete_func) {
+        print_dl_error("failed to load 'pv_koala_delete'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_process_func = load_symbol(koala_library, "pv_koala_process");
+    if (!pv_koala_process_func) {
+        print_dl_error("failed to load 'pv_koala_process'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_reset_func = load_symbol(koala_library, "pv_koala_reset");
+    if (!pv_koala_reset_func) {
+        print_dl_error("failed to load 'pv_koala_reset'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_frame_length_func = load_symbol(koala_library, "pv_koala_frame_length");
+    if (!pv_koala_frame_length_func) {
+        print_dl_error("failed to load 'pv_koala_frame_length'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_version_func = load_symbol(koala_library, "pv_koala_version");
+    if (!pv_koala_version_func) {
+        print_dl_error("failed to load 'pv_koala_version'");
+        exit(EXIT_FAILURE);
+    }
+
+    if (input_sample_rate != (uint32_t) pv_sample_rate_func()) {
+        fprintf(stderr, "audio sample rate should be %d.\n", pv_sample_rate_func());
+        exit(EXIT_FAILURE);
+    }
+
+    const int32_t frame_length = pv_koala_frame_length_func();
+    const int32_t num_input_frames = (int32_t) (num_samples / frame_length);
+    if (num_input_frames < 1) {
+        fprintf(stderr, "input should contain at least one frame of audio.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int32_t max_instances = 0;
+    for (int32_t i = 0; i < num_instance_counts; i++) {
+        if (instance_counts[i] > max_instances) {
+            max_instances = instance_counts[i];
+        }
+    }
+
+    pv_koala_t **instances = (pv_koala_t **) calloc(max_instances, sizeof(pv_koala_t *));
+    int16_t **enhanced_pcms = (int16_t **) calloc(max_instances, sizeof(int16_t *));
+    if (!instances || !enhanced_pcms) {
+        fprintf(stderr, "failed to allocate memory for instances.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int32_t i = 0; i < max_instances; i++) {
+        pv_status_t koala_status = pv_koala_init_func(access_key, model_path, &instances[i]);
+        if (koala_status != PV_STATUS_SUCCESS) {
+            fprintf(stderr, "failed to init with '%s'.\n", pv_status_to_string_func(koala_status));
+            exit(EXIT_FAILURE);
+        }
+        enhanced_pcms[i] = (int16_t *) malloc(frame_length * sizeof(int16_t));
+        if (!enhanced_pcms[i]) {
+            fprintf(stderr, "failed to allocate enhanced_pcm memory.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    const int32_t max_num_results = num_instance_counts * num_thread_counts * num_frames_per_call_counts;
+    sweep_result_t *results = (sweep_result_t *) calloc(max_num_results, sizeof(sweep_result_t));
+    if (!results) {
+        fprintf(stderr, "failed to allocate memory for results.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    fprintf(stdout, "V%s\n\n", pv_koala_version_func());
+    fprintf(stdout,
+            "instances | threads | frames/call |   frames/sec |   ns/frame | instructions/frame | cache misses/frame | "
+            "throttled\n");
+
+    // An instance must not be used by two threads at once, so configurations with more threads than instances are
+    // skipped.
+    int32_t num_results = 0;
+    for (int32_t i = 0; i < num_instance_counts; i++) {
+        for (int32_t j = 0; j < num_thread_counts; j++) {
+            if (thread_counts[j] > instance_counts[i]) {
+                continue;
+            }
+            for (int32_t k = 0; k < num_frames_per_call_counts; k++) {
+                sweep_config_t config;
+                memset(&config, 0, sizeof(config));
+                config.instances = instances;
+                config.enhanced_pcms = enhanced_pcms;
+                config.num_instances = instance_counts[i];
+                config.num_threads = thread_counts[j];
+                config.frames_per_call = frames_per_call_counts[k];
+                config.input_pcm = input_pcm;
+                config.num_input_frames = num_input_frames;
+                config.frame_length = frame_length;
+
+                sweep_result_t *result = &results[num_results++];
+                run_config(&config, seconds_per_config, result);
+
+                fprintf(stdout,
+                        "%9d | %7d | %11d | %12.1f | %10.1f | ",
+                        result->num_instances,
+                        result->num_threads,
+                        result->frames_per_call,
+                        result->frames_per_sec,
+                        result->nsec_per_frame);
+                if (result->has_counters) {
+                    fprintf(stdout,
+                            "%18.0f | %18.1f | ",
+                            result->instructions_per_frame,
+                            result->cache_misses_per_frame);
+                } else {
+                    fprintf(stdout, "%18s | %18s | ", "n/a", "n/a");
+                }
+                fprintf(stdout,
+                        "%s\n",
+                        koala_machine_state_throttled(result->machine_states, result->num_machine_states) ?
+                        "yes" : "no");
+                fflush(stdout);
+            }
+        }
+    }
+
+    if (json_path) {
+        FILE *json_file = fopen(json_path, "w");
+        if (!json_file) {
+            fprintf(stderr, "failed to open json file at '%s'.\n", json_path);
+            exit(EXIT_FAILURE);
+        }
+        fprintf(json_file, "{\n");
+        fprintf(json_file, "  \"version\": \"%s\",\n", pv_koala_version_func());
+        fprintf(json_file, "  \"frame_length\": %d,\n", frame_length);
+        fprintf(json_file, "  \"sample_rate\": %d,\n", pv_sample_rate_func());
+        fprintf(json_file, "  \"seconds_per_config\": %.3f,\n", seconds_per_config);
+        fprintf(json_file, "  \"results\": [");
+        for (int32_t i = 0; i < num_results; i++) {
+            const sweep_result_t *result = &results[i];
+            fprintf(json_file, "%s\n    {\n", (i == 0) ? "" : ",");
+            fprintf(json_file, "      \"num_instances\": %d,\n", result->num_instances);
+            fprintf(json_file, "      \"num_threads\": %d,\n", result->num_threads);
+            fprintf(json_file, "      \"frames_per_call\": %d,\n", result->frames_per_call);
+            fprintf(json_file, "      \"num_frames\": %" PRIu64 ",\n", result->num_frames);
+            fprintf(json_file, "      \"frames_per_sec\": %.3f,\n", result->frames_per_sec);
+            fprintf(json_file, "      \"nsec_per_frame\": %.3f,\n", result->nsec_per_frame);
+            if (result->has_counters) {
+                fprintf(json_file, "      \"instructions_per_frame\": %.3f,\n", result->instructions_per_frame);
+                fprintf(json_file, "      \"cache_misses_per_frame\": %.3f,\n", result->cache_misses_per_frame);
+            } else {
+                fprintf(json_file, "      \"instructions_per_frame\": null,\n");
+                fprintf(json_file, "      \"cache_misses_per_frame\": null,\n");
+            }
+            fprintf(json_file, "      \"machine_state\": ");
+            koala_machine_state_write_json(result->machine_states, result->num_machine_states, "      ", json_file);
+            fprintf(json_file, "\n");
+            fprintf(json_file, "    }");
+        }
+        fprintf(json_file, "\n  ]\n}\n");
+        fclose(json_file);
+    }
+
+    free(results);
+    for (int32_t i = 0; i < max_instances; i++) {
+        pv_koala_delete_func(instances[i]);
+        free(enhanced_pcms[i]);
+    }
+    free(instances);
+    free(enhanced_pcms);
+    free(input_pcm);
+    close_dl(koala_library);
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+    return picovoice_main(argc, argv);
+}
@@ -0,0 +1,833 @@
+/*
+    Copyright 2023 Picovoice Inc.
+
+    You may not use this file except in compliance with the license. A copy of the license is located in the "LICENSE"
+    file accompanying this source.
+
+    Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+    an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the
+    specific language governing permissions and limitations under the License.
+*/
+
+#include <ctype.h>
+#include <dirent.h>
+#include <getopt.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+
+#include <windows.h>
+
+#define PATH_SEPARATOR "\\"
+
+#else
+
+#include <dlfcn.h>
+#include <time.h>
+
+#define PATH_SEPARATOR "/"
+
+#endif
+
+#define DR_WAV_IMPLEMENTATION
+
+#include "dr_wav.h"
+
+#include "pv_koala.h"
+
+static void *open_dl(const char *dl_path) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    return LoadLibrary(dl_path);
+
+#else
+
+    return dlopen(dl_path, RTLD_NOW);
+
+#endif
+}
+
+static void *load_symbol(void *handle, const char *symbol) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    return GetProcAddress((HMODULE) handle, symbol);
+
+#else
+
+    return dlsym(handle, symbol);
+
+#endif
+}
+
+static void close_dl(void *handle) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    FreeLibrary((HMODULE) handle);
+
+#else
+
+    dlclose(handle);
+
+#endif
+}
+
+static void print_dl_error(const char *message) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    fprintf(stderr, "%s with code '%lu'.\n", message, GetLastError());
+
+#else
+
+    fprintf(stderr, "%s with '%s'.\n", message, dlerror());
+
+#endif
+}
+
+static double get_time_sec(void) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    static LARGE_INTEGER frequency = {0};
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+
+#else
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+
+#endif
+}
+
+static const char *(*pv_status_to_string_func)(pv_status_t) = NULL;
+static int32_t (*pv_sample_rate_func)() = NULL;
+static pv_status_t (*pv_koala_init_func)(const char *, const char *, pv_koala_t **) = NULL;
+static void (*pv_koala_delete_func)(pv_koala_t *) = NULL;
+static pv_status_t (*pv_koala_process_func)(pv_koala_t *, const int16_t *, int16_t *) = NULL;
+static pv_status_t (*pv_koala_reset_func)(pv_koala_t *) = NULL;
+static pv_status_t (*pv_koala_delay_sample_func)(const pv_koala_t *, int32_t *) = NULL;
+static int32_t (*pv_koala_frame_length_func)() = NULL;
+static const char *(*pv_koala_version_func)() = NULL;
+
+static struct option long_options[] = {
+        {"access_key",   required_argument, NULL, 'a'},
+        {"library_path", required_argument, NULL, 'l'},
+        {"model_path",   required_argument, NULL, 'm'},
+        {"input_path",   required_argument, NULL, 'i'},
+        {"output_dir",   required_argument, NULL, 'o'},
+        {"num_threads",  required_argument, NULL, 't'},
+        {"chunk_sec",    required_argument, NULL, 'c'},
+        {"warmup_sec",   required_argument, NULL, 'w'},
+        {NULL,           0,                 NULL, 0},
+};
+
+void print_usage(const char *program_name) {
+    fprintf(stdout,
+            "Usage: %s [-l LIBRARY_PATH -m MODEL_PATH -a ACCESS_KEY -i INPUT_PATH -o OUTPUT_DIR -t NUM_THREADS "
+            "-c CHUNK_SEC -w WARMUP_SEC]\n",
+            program_name);
+}
+
+typedef struct {
+    char **paths;
+    int32_t num_paths;
+    int32_t capacity;
+} path_list_t;
+
+static void path_list_append(path_list_t *list, const char *path) {
+    if (list->num_paths == list->capacity) {
+        list->capacity = (list->capacity == 0) ? 64 : (2 * list->capacity);
+        list->paths = (char **) realloc(list->paths, list->capacity * sizeof(char *));
+        if (!list->paths) {
+            fprintf(stderr, "failed to allocate memory for the input list.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    list->paths[list->num_paths] = strdup(path);
+    if (!list->paths[list->num_paths]) {
+        fprintf(stderr, "failed to allocate memory for the input list.\n");
+        exit(EXIT_FAILURE);
+    }
+    list->num_paths++;
+}
+
+static void path_list_free(path_list_t *list) {
+    for (int32_t i = 0; i < list->num_paths; i++) {
+        free(list->paths[i]);
+    }
+    free(list->paths);
+}
+
+static bool has_wav_extension(const char *path) {
+    const size_t length = strlen(path);
+    if (length < 4) {
+        return false;
+    }
+    const char *extension = &path[length - 4];
+    return (extension[0] == '.') &&
+           ((extension[1] == 'w') || (extension[1] == 'W')) &&
+           ((extension[2] == 'a') || (extension[2] == 'A')) &&
+           ((extension[3] == 'v') || (extension[3] == 'V'));
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(const char **) a, *(const char **) b);
+}
+
+/**
+ * Collects the `.wav` files of a directory (non-recursively), a single `.wav` file, or the paths listed in a manifest
+ * file with one path per line. Empty lines and lines starting with `#` in a manifest are ignored.
+ */
+static void collect_inputs(const char *input_path, path_list_t *inputs) {
+    struct stat input_stat;
+    if (stat(input_path, &input_stat) != 0) {
+        fprintf(stderr, "failed to find '%s'.\n", input_path);
+        exit(EXIT_FAILURE);
+    }
+
+    if (S_ISDIR(input_stat.st_mode)) {
+        DIR *dir = opendir(input_path);
+        if (!dir) {
+            fprintf(stderr, "failed to open directory '%s'.\n", input_path);
+            exit(EXIT_FAILURE);
+        }
+
+        struct dirent *entry = NULL;
+        while ((entry = readdir(dir)) != NULL) {
+            if (!has_wav_extension(entry->d_name)) {
+                continue;
+            }
+            char path[4096];
+            snprintf(path, sizeof(path), "%s" PATH_SEPARATOR "%s", input_path, entry->d_name);
+            path_list_append(inputs, path);
+        }
+        closedir(dir);
+
+        qsort(inputs->paths, inputs->num_paths, sizeof(char *), compare_paths);
+    } else if (has_wav_extension(input_path)) {
+        path_list_append(inputs, input_path);
+    } else {
+        FILE *manifest = fopen(input_path, "r");
+        if (!manifest) {
+            fprintf(stderr, "failed to open manifest '%s'.\n", input_path);
+            exit(EXIT_FAILURE);
+        }
+
+        char line[4096];
+        while (fgets(line, sizeof(line), manifest)) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if ((line[0] == '\0') || (line[0] == '#')) {
+                continue;
+            }
+            path_list_append(inputs, line);
+        }
+        fclose(manifest);
+    }
+}
+
+static const char *path_basename(const char *path) {
+    const char *basename = path;
+    for (const char *p = path; *p != '\0'; p++) {
+        if ((*p == '/') || (*p == '\\')) {
+            basename = p + 1;
+        }
+    }
+    return basename;
+}
+
+// Case-insensitive, since the output directory may be on a case-insensitive file system.
+static int compare_basenames(const void *a, const void *b) {
+    const char *x = path_basename(*(const char **) a);
+    const char *y = path_basename(*(const char **) b);
+    while ((*x != '\0') && (tolower((unsigned char) *x) == tolower((unsigned char) *y))) {
+        x++;
+        y++;
+    }
+    return tolower((unsigned char) *x) - tolower((unsigned char) *y);
+}
+
+/**
+ * Exits if two inputs share a file name. Outputs are named after the input file alone, so workers would write both
+ * inputs to the same output file at the same time.
+ */
+static void check_unique_basenames(const path_list_t *inputs) {
+    const char **sorted_paths = (const char **) malloc(inputs->num_paths * sizeof(char *));
+    if (!sorted_paths) {
+        fprintf(stderr, "failed to allocate memory for the input list.\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(sorted_paths, inputs->paths, inputs->num_paths * sizeof(char *));
+    qsort(sorted_paths, inputs->num_paths, sizeof(char *), compare_basenames);
+
+    for (int32_t i = 1; i < inputs->num_paths; i++) {
+        if (compare_basenames(&sorted_paths[i - 1], &sorted_paths[i]) == 0) {
+            fprintf(
+                    stderr,
+                    "inputs '%s' and '%s' would both be written to '%s' in the output directory.\n",
+                    sorted_paths[i - 1],
+                    sorted_paths[i],
+                    path_basename(sorted_paths[i]));
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    free(sorted_paths);
+}
+
+/**
+ * A contiguous range of output samples `[start_sample, end_sample)` of one input file. Without chunking every file is a
+ * single work item whose range is resolved by the worker once it opens the file.
+ */
+typedef struct {
+    int32_t input_index;
+    size_t start_sample;
+    size_t end_sample;
+    bool is_whole_file;
+} work_item_t;
+
+typedef struct {
+    int32_t num_items_remaining;
+    bool is_failed;
+} input_state_t;
+
+typedef struct {
+    const char *output_dir;
+    const path_list_t *inputs;
+    input_state_t *input_states;
+    work_item_t *items;
+    int32_t num_items;
+    size_t warmup_samples;
+
+    pthread_mutex_t mutex;
+    int32_t next_item;
+    int32_t num_items_done;
+    int32_t num_files_done;
+    int32_t num_files_failed;
+    double total_audio_sec;
+} batch_t;
+
+typedef struct {
+    batch_t *batch;
+    pv_koala_t *koala;
+    int16_t *pcm;
+    int16_t *enhanced_pcm;
+} worker_t;
+
+#define WAV_HEADER_SIZE (44)
+
+static int seek_file(FILE *file, int64_t offset) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    return _fseeki64(file, offset, SEEK_SET);
+
+#else
+
+    return fseeko(file, (off_t) offset, SEEK_SET);
+
+#endif
+}
+
+static void set_uint16_le(uint8_t *buffer, uint16_t value) {
+    buffer[0] = (uint8_t) (value & 0xFF);
+    buffer[1] = (uint8_t) (value >> 8);
+}
+
+static void set_uint32_le(uint8_t *buffer, uint32_t value) {
+    for (int32_t i = 0; i < 4; i++) {
+        buffer[i] = (uint8_t) ((value >> (8 * i)) & 0xFF);
+    }
+}
+
+static void build_output_path(const batch_t *batch, int32_t input_index, char *output_path, size_t size) {
+    const char *input_path = batch->inputs->paths[input_index];
+    snprintf(output_path, size, "%s" PATH_SEPARATOR "%s", batch->output_dir, path_basename(input_path));
+}
+
+/**
+ * Validates the format of the input file and creates the output file with a canonical WAV header sized for the whole
+ * input. Samples are later written in place, which lets chunks of the same file be written by different workers.
+ */
+static bool prepare_output(const char *input_path, const char *output_path, size_t *num_samples) {
+    if (strcmp(input_path, output_path) == 0) {
+        fprintf(stderr, "cannot overwrite input file '%s'.\n", input_path);
+        return false;
+    }
+
+    drwav input_file;
+    if (!drwav_init_file(&input_file, input_path, NULL)) {
+        fprintf(stderr, "failed to open wav file at '%s'.\n", input_path);
+        return false;
+    }
+
+    const int32_t sample_rate = pv_sample_rate_func();
+    const bool is_valid_format = (input_file.sampleRate == (uint32_t) sample_rate) &&
+                                 (input_file.bitsPerSample == 16) &&
+                                 (input_file.channels == 1);
+    *num_samples = (size_t) input_file.totalPCMFrameCount;
+    drwav_uninit(&input_file);
+
+    if (!is_valid_format) {
+        fprintf(stderr, "'%s' should be single-channel 16-bit PCM sampled at %d Hz.\n", input_path, sample_rate);
+        return false;
+    }
+
+    const uint64_t data_size = (uint64_t) *num_samples * sizeof(int16_t);
+    if (data_size > UINT32_MAX - WAV_HEADER_SIZE) {
+        fprintf(stderr, "'%s' is too long for a WAV file.\n", input_path);
+        return false;
+    }
+
+    uint8_t header[WAV_HEADER_SIZE];
+    memcpy(&header[0], "RIFF", 4);
+    set_uint32_le(&header[4], (uint32_t) (data_size + WAV_HEADER_SIZE - 8));
+    memcpy(&header[8], "WAVEfmt ", 8);
+    set_uint32_le(&header[16], 16);
+    set_uint16_le(&header[20], DR_WAVE_FORMAT_PCM);
+    set_uint16_le(&header[22], 1);
+    set_uint32_le(&header[24], (uint32_t) sample_rate);
+    set_uint32_le(&header[28], (uint32_t) sample_rate * sizeof(int16_t));
+    set_uint16_le(&header[32], sizeof(int16_t));
+    set_uint16_le(&header[34], 16);
+    memcpy(&header[36], "data", 4);
+    set_uint32_le(&header[40], (uint32_t) data_size);
+
+    FILE *output_file = fopen(output_path, "wb");
+    if (!output_file) {
+        fprintf(stderr, "failed to open the output file at '%s'.\n", output_path);
+        return false;
+    }
+    const bool is_success = fwrite(header, 1, WAV_HEADER_SIZE, output_file) == WAV_HEADER_SIZE;
+    fclose(output_file);
+
+    return is_success;
+}
+
+/**
+ * Enhances the output range of a work item. Processing starts `warmup_samples` before the range (rounded to whole
+ * frames) so the instance has settled by the time its output is kept, and continues past the range until the delayed
+ * output covering its last sample has come out. Input beyond the end of the file is zero-padded, exactly as in
+ * `koala_demo_file`. Memory use is two frames regardless of file or chunk length.
+ */
+static bool enhance_range(
+        worker_t *worker,
+        const char *input_path,
+        const char *output_path,
+        size_t start_sample,
+        size_t end_sample,
+        size_t warmup_samples) {
+    const int32_t frame_length = pv_koala_frame_length_func();
+
+    int32_t delay_sample = 0;
+    pv_status_t status = pv_koala_delay_sample_func(worker->koala, &delay_sample);
+    if (status != PV_STATUS_SUCCESS) {
+        fprintf(stderr, "failed to get delay sample with '%s'.\n", pv_status_to_string_func(status));
+        return false;
+    }
+
+    drwav input_file;
+    if (!drwav_init_file(&input_file, input_path, NULL)) {
+        fprintf(stderr, "failed to open wav file at '%s'.\n", input_path);
+        return false;
+    }
+
+    FILE *output_file = fopen(output_path, "r+b");
+    if (!output_file) {
+        fprintf(stderr, "failed to open the output file at '%s'.\n", output_path);
+        drwav_uninit(&input_file);
+        return false;
+    }
+
+    const size_t warmup_start_sample = (start_sample > warmup_samples) ? (start_sample - warmup_samples) : 0;
+    bool is_success = (pv_koala_reset_func(worker->koala) == PV_STATUS_SUCCESS) &&
+                      drwav_seek_to_pcm_frame(&input_file, warmup_start_sample) &&
+                      (seek_file(output_file, WAV_HEADER_SIZE + (int64_t) start_sample * sizeof(int16_t)) == 0);
+
+    size_t input_sample = warmup_start_sample;
+    while (is_success && (input_sample < end_sample + delay_sample)) {
+        memset(worker->pcm, 0, frame_length * sizeof(int16_t));
+        drwav_read_pcm_frames_s16(&input_file, frame_length, worker->pcm);
+
+        status = pv_koala_process_func(worker->koala, worker->pcm, worker->enhanced_pcm);
+        if (status != PV_STATUS_SUCCESS) {
+            fprintf(stderr, "'pv_koala_process' failed with '%s'.\n", pv_status_to_string_func(status));
+            is_success = false;
+            break;
+        }
+
+        // This output frame holds the enhanced samples `[input_sample - delay_sample, + frame_length)` of the input.
+        size_t output_begin = input_sample;
+        size_t output_end = input_sample + frame_length;
+        if (output_end > start_sample + delay_sample) {
+            output_begin = (output_begin > start_sample + delay_sample) ? output_begin : (start_sample + delay_sample);
+            output_end = (output_end < end_sample + delay_sample) ? output_end : (end_sample + delay_sample);
+
+            const size_t pcm_to_write_length = output_end - output_begin;
+            const int16_t *pcm_to_write = &worker->enhanced_pcm[output_begin - input_sample];
+            if (fwrite(pcm_to_write, sizeof(int16_t), pcm_to_write_length, output_file) != pcm_to_write_length) {
+                fprintf(stderr, "failed to write to '%s'.\n", output_path);
+                is_success = false;
+            }
+        }
+
+        input_sample += frame_length;
+    }
+
+    if (fclose(output_file) != 0) {
+        is_success = false;
+    }
+    drwav_uninit(&input_file);
+
+    return is_success;
+}
+
+static void print_progress_bar(int32_t num_total, int32_t num_done) {
+    float ratio = (float) num_done / (float) num_total;
+    int32_t percentage = (int32_t) roundf(ratio * 100);
+    int32_t bar_length = ((int32_t) roundf(ratio * 20));
+    int32_t empty_length = 20 - (bar_length);
+    fprintf(stdout,
+            "\r[%3d%%]%.*s%.*s| %d/%d", percentage,
+            bar_length, "####################",
+            empty_length, "                    ",
+            num_done, num_total);
+    fflush(stdout);
+}
+
+static void finish_item(batch_t *batch, const work_item_t *item, bool is_success) {
+    pthread_mutex_lock(&batch->mutex);
+
+    input_state_t *input_state = &batch->input_states[item->input_index];
+    if (is_success) {
+        batch->total_audio_sec += (double) (item->end_sample - item->start_sample) / pv_sample_rate_func();
+    } else {
+        input_state->is_failed = true;
+    }
+
+    input_state->num_items_remaining--;
+    if (input_state->num_items_remaining == 0) {
+        batch->num_files_done++;
+        if (input_state->is_failed) {
+            batch->num_files_failed++;
+            fprintf(stderr, "\nfailed to enhance '%s'.\n", batch->inputs->paths[item->input_index]);
+        }
+    }
+
+    batch->num_items_done++;
+    print_progress_bar(batch->num_items, batch->num_items_done);
+
+    pthread_mutex_unlock(&batch->mutex);
+}
+
+static void *worker_thread(void *arg) {
+    worker_t *worker = (worker_t *) arg;
+    batch_t *batch = worker->batch;
+
+    while (true) {
+        pthread_mutex_lock(&batch->mutex);
+        const int32_t index = batch->next_item++;
+        pthread_mutex_unlock(&batch->mutex);
+
+        if (index >= batch->num_items) {
+            break;
+        }
+
+        work_item_t item = batch->items[index];
+        const char *input_path = batch->inputs->paths[item.input_index];
+        char output_path[4096];
+        build_output_path(batch, item.input_index, output_path, sizeof(output_path));
+
+        bool is_success = true;
+        if (item.is_whole_file) {
+            is_success = prepare_output(input_path, output_path, &item.end_sample);
+        }
+        if (is_success) {
+            is_success = enhance_range(
+                    worker,
+                    input_path,
+                    output_path,
+                    item.start_sample,
+                    item.end_sample,
+                    batch->warmup_samples);
+        }
+
+        finish_item(batch, &item, is_success);
+    }
+
+    return NULL;
+}
+
+int picovoice_main(int argc, char *argv[]) {
+    const char *library_path = NULL;
+    const char *model_path = NULL;
+    const char *access_key = NULL;
+    const char *input_path = NULL;
+    const char *output_dir = NULL;
+    int32_t num_threads = 1;
+    float chunk_sec = 0.f;
+    float warmup_sec = 1.f;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "l:m:a:i:o:t:c:w:", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'l':
+                library_path = optarg;
+                break;
+            case 'm':
+                model_path = optarg;
+                break;
+            case 'a':
+                access_key = optarg;
+                break;
+            case 'i':
+                input_path = optarg;
+                break;
+            case 'o':
+                output_dir = optarg;
+                break;
+            case 't':
+                num_threads = (int32_t) strtol(optarg, NULL, 10);
+                break;
+            case 'c':
+                chunk_sec = strtof(optarg, NULL);
+                break;
+            case 'w':
+                warmup_sec = strtof(optarg, NULL);
+                break;
+            default:
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    if (!library_path || !access_key || !input_path || !output_dir || (num_threads < 1) || (chunk_sec < 0.f) ||
+        (warmup_sec < 0.f)) {
+        print_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    void *koala_library = open_dl(library_path);
+    if (!koala_library) {
+        fprintf(stderr, "failed to open library at '%s'.\n", library_path);
+        exit(EXIT_FAILURE);
+    }
+
+    pv_status_to_string_func = load_symbol(koala_library, "pv_status_to_string");
+    if (!pv_status_to_string_func) {
+        print_dl_error("failed to load 'pv_status_to_string'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_sample_rate_func = load_symbol(koala_library, "pv_sample_rate");
+    if (!pv_sample_rate_func) {
+        print_dl_error("failed to load 'pv_sample_rate'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_init_func = load_symbol(koala_library, "pv_koala_init");
+    if (!pv_koala_init_func) {
+        print_dl_error("failed to load 'pv_koala_init'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_delete_func = load_symbol(koala_library, "pv_koala_delete");
+    if (!pv_koala_delete_func) {
+        print_dl_error("failed to load 'pv_koala_delete'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_process_func = load_symbol(koala_library, "pv_koala_process");
+    if (!pv_koala_process_func) {
+        print_dl_error("failed to load 'pv_koala_process'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_reset_func = load_symbol(koala_library, "pv_koala_reset");
+    if (!pv_koala_reset_func) {
+        print_dl_error("failed to load 'pv_koala_reset'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_delay_sample_func = load_symbol(koala_library, "pv_koala_delay_sample");
+    if (!pv_koala_delay_sample_func) {
+        print_dl_error("failed to load 'pv_koala_delay_sample'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_frame_length_func = load_symbol(koala_library, "pv_koala_frame_length");
+    if (!pv_koala_frame_length_func) {
+        print_dl_error("failed to load 'pv_koala_frame_length'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_version_func = load_symbol(koala_library, "pv_koala_version");
+    if (!pv_koala_version_func) {
+        print_dl_error("failed to load 'pv_koala_version'");
+        exit(EXIT_FAILURE);
+    }
+
+    path_list_t inputs = {NULL, 0, 0};
+    collect_inputs(input_path, &inputs);
+    if (inputs.num_paths == 0) {
+        fprintf(stderr, "no input files found in '%s'.\n", input_path);
+        exit(EXIT_FAILURE);
+    }
+    check_unique_basenames(&inputs);
+
+    const int32_t frame_length = pv_koala_frame_length_func();
+
+    batch_t batch;
+    memset(&batch, 0, sizeof(batch));
+    batch.output_dir = output_dir;
+    batch.inputs = &inputs;
+    pthread_mutex_init(&batch.mutex, NULL);
+
+    batch.input_states = (input_state_t *) calloc(inputs.num_paths, sizeof(input_state_t));
+    if (!batch.input_states) {
+        fprintf(stderr, "failed to allocate memory for the input list.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Chunk and warm-up lengths are whole frames, so every chunk processes frames on the same sample grid as a
+    // sequential run over the file.
+    const size_t chunk_samples =
+            (size_t) ceilf(chunk_sec * (float) pv_sample_rate_func() / (float) frame_length) * frame_length;
+    batch.warmup_samples =
+            (size_t) ceilf(warmup_sec * (float) pv_sample_rate_func() / (float) frame_length) * frame_length;
+
+    int32_t items_capacity = inputs.num_paths;
+    batch.items = (work_item_t *) malloc(items_capacity * sizeof(work_item_t));
+    if (!batch.items) {
+        fprintf(stderr, "failed to allocate memory for work items.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int32_t i = 0; i < inputs.num_paths; i++) {
+        if (chunk_samples == 0) {
+            work_item_t item = {i, 0, 0, true};
+            batch.items[batch.num_items++] = item;
+            batch.input_states[i].num_items_remaining = 1;
+            continue;
+        }
+
+        char output_path[4096];
+        build_output_path(&batch, i, output_path, sizeof(output_path));
+        size_t num_samples = 0;
+        if (!prepare_output(inputs.paths[i], output_path, &num_samples)) {
+            batch.num_files_done++;
+            batch.num_files_failed++;
+            continue;
+        }
+
+        for (size_t start_sample = 0; start_sample < num_samples; start_sample += chunk_samples) {
+            if (batch.num_items == items_capacity) {
+                items_capacity *= 2;
+                batch.items = (work_item_t *) realloc(batch.items, items_capacity * sizeof(work_item_t));
+                if (!batch.items) {
+                    fprintf(stderr, "failed to allocate memory for work items.\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+
+            const size_t end_sample =
+                    (start_sample + chunk_samples < num_samples) ? (start_sample + chunk_samples) : num_samples;
+            work_item_t item = {i, start_sample, end_sample, false};
+            batch.items[batch.num_items++] = item;
+            batch.input_states[i].num_items_remaining++;
+        }
+    }
+
+    if (batch.num_items == 0) {
+        fprintf(stderr, "no input files to enhance.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (num_threads > batch.num_items) {
+        num_threads = batch.num_items;
+    }
+
+    worker_t *workers = (worker_t *) calloc(num_threads, sizeof(worker_t));
+    pthread_t *threads = (pthread_t *) calloc(num_threads, sizeof(pthread_t));
+    if (!workers || !threads) {
+        fprintf(stderr, "failed to allocate memory for workers.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int32_t i = 0; i < num_threads; i++) {
+        workers[i].batch = &batch;
+
+        pv_status_t koala_status = pv_koala_init_func(access_key, model_path, &workers[i].koala);
+        if (koala_status != PV_STATUS_SUCCESS) {
+            fprintf(stderr, "failed to init with '%s'.\n", pv_status_to_string_func(koala_status));
+            exit(EXIT_FAILURE);
+        }
+
+        workers[i].pcm = (int16_t *) malloc(frame_length * sizeof(int16_t));
+        workers[i].enhanced_pcm = (int16_t *) malloc(frame_length * sizeof(int16_t));
+        if (!workers[i].pcm || !workers[i].enhanced_pcm) {
+            fprintf(stderr, "failed to allocate pcm memory.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    fprintf(stdout, "V%s\n\n", pv_koala_version_func());
+    fprintf(stdout,
+            "Enhancing %d files (%d work items) with %d threads...\n",
+            inputs.num_paths,
+            batch.num_items,
+            num_threads);
+
+    const double start_sec = get_time_sec();
+
+    for (int32_t i = 0; i < num_threads; i++) {
+        if (pthread_create(&threads[i], NULL, worker_thread, &workers[i]) != 0) {
+            fprintf(stderr, "failed to create worker thread.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int32_t i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    const double wall_sec = get_time_sec() - start_sec;
+
+    fprintf(stdout, "\n\n");
+    fprintf(stdout, "files enhanced : %d\n", batch.num_files_done - batch.num_files_failed);
+    fprintf(stdout, "files failed   : %d\n", batch.num_files_failed);
+    fprintf(stdout, "audio          : %.2f hours\n", batch.total_audio_sec / 3600.0);
+    fprintf(stdout, "wall clock     : %.2f seconds\n", wall_sec);
+    fprintf(stdout, "throughput     : %.1f audio hours per wall-clock hour\n", batch.total_audio_sec / wall_sec);
+
+    for (int32_t i = 0; i < num_threads; i++) {
+        free(workers[i].pcm);
+        free(workers[i].enhanced_pcm);
+        pv_koala_delete_func(workers[i].koala);
+    }
+    free(workers);
+    free(threads);
+    free(batch.items);
+    free(batch.input_states);
+    pthread_mutex_destroy(&batch.mutex);
+    path_list_free(&inputs);
+    close_dl(koala_library);
+
+    return (batch.num_files_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char *argv[]) {
+    return picovoice_main(argc, argv);
+}
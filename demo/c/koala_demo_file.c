@@ -7,11 +7,16 @@
     specific language governing permissions and limitations under the License.
 */
 
+#include <errno.h>
 #include <getopt.h>
 #include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/time.h>
+#include <string.h>
+#include <time.h>
 
 #if defined(_WIN32) || defined(_WIN64)
 
@@ -23,6 +28,10 @@
 #else
 
 #include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #endif
 
@@ -32,6 +41,9 @@
 
 #include "pv_koala.h"
 
+#include "koala_latency_histogram.h"
+#include "koala_ring_buffer.h"
+
 static void *open_dl(const char *dl_path) {
 
 #if defined(_WIN32) || defined(_WIN64)
@@ -90,10 +102,17 @@ static struct option long_options[] = {
         {"model_path",   required_argument, NULL, 'm'},
         {"input_path",   required_argument, NULL, 'i'},
         {"output_path",  required_argument, NULL, 'o'},
+        {"mmap",         no_argument,       NULL, 'z'},
+        {"pipeline",     no_argument,       NULL, 'p'},
+        {"latency_csv",  required_argument, NULL, 'c'},
+        {"latency_json", required_argument, NULL, 'j'},
+        {NULL,           0,                 NULL, 0},
 };
 
 void print_usage(const char *program_name) {
-    fprintf(stdout, "Usage: %s [-l LIBRARY_PATH -m MODEL_PATH -a ACCESS_KEY -i INPUT_PATH -o OUTPUT_PATH]\n",
+    fprintf(stdout,
+            "Usage: %s [-l LIBRARY_PATH -m MODEL_PATH -a ACCESS_KEY -i INPUT_PATH -o OUTPUT_PATH] [-z | -p] "
+            "[-c LATENCY_CSV_PATH] [-j LATENCY_JSON_PATH]\n",
             program_name);
 }
 
@@ -109,6 +128,433 @@ static void print_progress_bar(size_t num_total_samples, size_t num_processed_sa
     fflush(stdout);
 }
 
+static double get_time_usec(void) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    static LARGE_INTEGER frequency = {0};
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (double) counter.QuadPart * 1e6 / (double) frequency.QuadPart;
+
+#else
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec * 1e6 + (double) now.tv_nsec * 1e-3;
+
+#endif
+}
+
+static void record_latency(koala_latency_histogram_t *latency_histogram, double before_usec, double after_usec) {
+    koala_latency_histogram_record(latency_histogram, (uint64_t) ((after_usec - before_usec) * 1e3 + 0.5));
+}
+
+static void write_latency_file(
+        const char *path,
+        const koala_latency_histogram_t *latency_histogram,
+        void (*write_func)(const koala_latency_histogram_t *, FILE *)) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "failed to open '%s' for writing.\n", path);
+        exit(EXIT_FAILURE);
+    }
+    write_func(latency_histogram, f);
+    fclose(f);
+}
+
+/**
+ * Prints the distribution of `pv_koala_process` call times and optionally exports the full histogram.
+ */
+static void report_latency(
+        const koala_latency_histogram_t *latency_histogram,
+        const char *latency_csv_path,
+        const char *latency_json_path) {
+    static const double PERCENTILES[] = {50., 90., 99., 99.9};
+    static const char *PERCENTILE_NAMES[] = {"p50", "p90", "p99", "p99.9"};
+
+    fprintf(stdout, "frame latency (usec) :\n");
+    for (int32_t i = 0; i < (int32_t) (sizeof(PERCENTILES) / sizeof(PERCENTILES[0])); i++) {
+        fprintf(stdout,
+                "  %-5s : %.1f\n",
+                PERCENTILE_NAMES[i],
+                (double) koala_latency_histogram_percentile(latency_histogram, PERCENTILES[i]) * 1e-3);
+    }
+    fprintf(stdout, "  %-5s : %.1f\n", "max", (double) latency_histogram->max_value * 1e-3);
+
+    if (latency_csv_path) {
+        write_latency_file(latency_csv_path, latency_histogram, koala_latency_histogram_write_csv);
+    }
+    if (latency_json_path) {
+        write_latency_file(latency_json_path, latency_histogram, koala_latency_histogram_write_json);
+    }
+}
+
+// 64 frames of 256 samples buffer about a second of audio between two stages.
+#define PIPELINE_NUM_SLOTS (64)
+
+typedef enum {
+    PIPELINE_STAGE_READ = 0,
+    PIPELINE_STAGE_ENHANCE,
+    PIPELINE_STAGE_WRITE,
+    PIPELINE_NUM_STAGES,
+} pipeline_stage_t;
+
+static const char *PIPELINE_STAGE_NAMES[PIPELINE_NUM_STAGES] = {"reader", "koala", "writer"};
+
+/**
+ * Three-stage pipeline over a file: a reader thread decodes frames into `input_ring`, a Koala thread enhances them
+ * from `input_ring` into `output_ring`, and a writer thread trims the delay and appends them to the output file. Every
+ * stage knows the total number of frames up front, so no end-of-stream signalling is needed. Each stage accumulates
+ * the time spent in its own work (`busy_usec`) and its lifetime (`wall_usec`), which give its utilization.
+ */
+typedef struct {
+    drwav *input_file;
+    drwav *output_file;
+    pv_koala_t *koala;
+    pv_status_t (*pv_koala_process_func)(pv_koala_t *, const int16_t *, int16_t *);
+    const char *(*pv_status_to_string_func)(pv_status_t);
+    int32_t frame_length;
+    int32_t delay_samples;
+    size_t total_samples;
+    uint32_t num_frames;
+    koala_ring_buffer_t input_ring;
+    koala_ring_buffer_t output_ring;
+    koala_latency_histogram_t *latency_histogram;
+    double busy_usec[PIPELINE_NUM_STAGES];
+    double wall_usec[PIPELINE_NUM_STAGES];
+} pipeline_t;
+
+static void *pipeline_read(void *arg) {
+    pipeline_t *pipeline = (pipeline_t *) arg;
+    const double start_usec = get_time_usec();
+
+    for (uint32_t i = 0; i < pipeline->num_frames; i++) {
+        int16_t *pcm = NULL;
+        while (!(pcm = (int16_t *) koala_ring_buffer_acquire_write(&pipeline->input_ring))) {
+            sched_yield();
+        }
+
+        const double before_usec = get_time_usec();
+        const size_t num_read = (size_t) drwav_read_pcm_frames_s16(pipeline->input_file, pipeline->frame_length, pcm);
+        if (num_read < (size_t) pipeline->frame_length) {
+            memset(pcm + num_read, 0, (pipeline->frame_length - num_read) * sizeof(int16_t));
+        }
+        pipeline->busy_usec[PIPELINE_STAGE_READ] += get_time_usec() - before_usec;
+
+        koala_ring_buffer_commit_write(&pipeline->input_ring);
+    }
+
+    pipeline->wall_usec[PIPELINE_STAGE_READ] = get_time_usec() - start_usec;
+    return NULL;
+}
+
+static void *pipeline_enhance(void *arg) {
+    pipeline_t *pipeline = (pipeline_t *) arg;
+    const double start_usec = get_time_usec();
+
+    for (uint32_t i = 0; i < pipeline->num_frames; i++) {
+        const int16_t *pcm = NULL;
+        while (!(pcm = (const int16_t *) koala_ring_buffer_acquire_read(&pipeline->input_ring))) {
+            sched_yield();
+        }
+        int16_t *enhanced_pcm = NULL;
+        while (!(enhanced_pcm = (int16_t *) koala_ring_buffer_acquire_write(&pipeline->output_ring))) {
+            sched_yield();
+        }
+
+        const double before_usec = get_time_usec();
+        pv_status_t koala_status = pipeline->pv_koala_process_func(pipeline->koala, pcm, enhanced_pcm);
+        if (koala_status != PV_STATUS_SUCCESS) {
+            fprintf(
+                    stderr,
+                    "'pv_koala_process' failed with '%s'\n",
+                    pipeline->pv_status_to_string_func(koala_status));
+            exit(EXIT_FAILURE);
+        }
+        const double after_usec = get_time_usec();
+        pipeline->busy_usec[PIPELINE_STAGE_ENHANCE] += after_usec - before_usec;
+        record_latency(pipeline->latency_histogram, before_usec, after_usec);
+
+        koala_ring_buffer_release_read(&pipeline->input_ring);
+        koala_ring_buffer_commit_write(&pipeline->output_ring);
+    }
+
+    pipeline->wall_usec[PIPELINE_STAGE_ENHANCE] = get_time_usec() - start_usec;
+    return NULL;
+}
+
+static void *pipeline_write(void *arg) {
+    pipeline_t *pipeline = (pipeline_t *) arg;
+    const double start_usec = get_time_usec();
+    const size_t end = pipeline->total_samples + pipeline->delay_samples;
+
+    for (uint32_t i = 0; i < pipeline->num_frames; i++) {
+        const int16_t *enhanced_pcm = NULL;
+        while (!(enhanced_pcm = (const int16_t *) koala_ring_buffer_acquire_read(&pipeline->output_ring))) {
+            sched_yield();
+        }
+
+        const double before_usec = get_time_usec();
+        const size_t start_sample = (size_t) i * pipeline->frame_length;
+        const size_t end_sample = start_sample + pipeline->frame_length;
+        if (end_sample > (size_t) pipeline->delay_samples) {
+            const size_t write_start =
+                    (start_sample > (size_t) pipeline->delay_samples) ? start_sample : (size_t) pipeline->delay_samples;
+            const size_t write_end = (end_sample < end) ? end_sample : end;
+            const size_t write_length = write_end - write_start;
+            if (drwav_write_pcm_frames(
+                    pipeline->output_file,
+                    write_length,
+                    enhanced_pcm + (write_start - start_sample)) != write_length) {
+                fprintf(stderr, "Failed to write to output file.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        pipeline->busy_usec[PIPELINE_STAGE_WRITE] += get_time_usec() - before_usec;
+
+        koala_ring_buffer_release_read(&pipeline->output_ring);
+
+        print_progress_bar(pipeline->total_samples, end_sample);
+    }
+
+    pipeline->wall_usec[PIPELINE_STAGE_WRITE] = get_time_usec() - start_usec;
+    return NULL;
+}
+
+/**
+ * Runs the file through the reader, Koala and writer threads, then prints the utilization of each stage.
+ *
+ * @return Real time factor of the processing.
+ */
+static double enhance_pipelined(pipeline_t *pipeline, int32_t sample_rate) {
+    const size_t slot_size = pipeline->frame_length * sizeof(int16_t);
+    if (!koala_ring_buffer_init(&pipeline->input_ring, slot_size, PIPELINE_NUM_SLOTS) ||
+        !koala_ring_buffer_init(&pipeline->output_ring, slot_size, PIPELINE_NUM_SLOTS)) {
+        fprintf(stderr, "Failed to allocate pipeline memory.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    const size_t end = pipeline->total_samples + pipeline->delay_samples;
+    pipeline->num_frames = (uint32_t) ((end + pipeline->frame_length - 1) / pipeline->frame_length);
+
+    void *(*stage_funcs[PIPELINE_NUM_STAGES])(void *) = {pipeline_read, pipeline_enhance, pipeline_write};
+    pthread_t threads[PIPELINE_NUM_STAGES];
+    for (int32_t i = 0; i < PIPELINE_NUM_STAGES; i++) {
+        if (pthread_create(&threads[i], NULL, stage_funcs[i], pipeline) != 0) {
+            fprintf(stderr, "failed to start the %s thread.\n", PIPELINE_STAGE_NAMES[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int32_t i = 0; i < PIPELINE_NUM_STAGES; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    koala_ring_buffer_free(&pipeline->input_ring);
+    koala_ring_buffer_free(&pipeline->output_ring);
+
+    fprintf(stdout, "\n\nstage utilization :\n");
+    for (int32_t i = 0; i < PIPELINE_NUM_STAGES; i++) {
+        const double utilization =
+                (pipeline->wall_usec[i] > 0) ? (100. * pipeline->busy_usec[i] / pipeline->wall_usec[i]) : 0.;
+        fprintf(stdout, "  %-6s : %5.1f%%\n", PIPELINE_STAGE_NAMES[i], utilization);
+    }
+
+    const double total_processed_time_usec = (pipeline->num_frames * pipeline->frame_length * 1e6) / sample_rate;
+    return pipeline->busy_usec[PIPELINE_STAGE_ENHANCE] / total_processed_time_usec;
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+
+#define WAV_HEADER_SIZE (44)
+
+static void set_uint16_le(uint8_t *dst, uint16_t value) {
+    dst[0] = (uint8_t) (value & 0xFF);
+    dst[1] = (uint8_t) ((value >> 8) & 0xFF);
+}
+
+static void set_uint32_le(uint8_t *dst, uint32_t value) {
+    for (int32_t i = 0; i < 4; i++) {
+        dst[i] = (uint8_t) ((value >> (8 * i)) & 0xFF);
+    }
+}
+
+static void write_wav_header(uint8_t *header, uint32_t num_samples, int32_t sample_rate) {
+    const uint32_t data_size = num_samples * sizeof(int16_t);
+
+    memcpy(header, "RIFF", 4);
+    set_uint32_le(header + 4, 36 + data_size);
+    memcpy(header + 8, "WAVE", 4);
+    memcpy(header + 12, "fmt ", 4);
+    set_uint32_le(header + 16, 16);
+    set_uint16_le(header + 20, DR_WAVE_FORMAT_PCM);
+    set_uint16_le(header + 22, 1);
+    set_uint32_le(header + 24, (uint32_t) sample_rate);
+    set_uint32_le(header + 28, (uint32_t) sample_rate * sizeof(int16_t));
+    set_uint16_le(header + 32, sizeof(int16_t));
+    set_uint16_le(header + 34, 16);
+    memcpy(header + 36, "data", 4);
+    set_uint32_le(header + 40, data_size);
+}
+
+/**
+ * Enhances a file through memory-mapped input and output. The data chunk of the input file is mapped read-only and
+ * every full frame is passed to `pv_koala_process` without a copy. The output file is pre-sized, mapped, and enhanced
+ * frames are written in place at their delay-compensated position. Only the frames that straddle either end of the
+ * file go through the intermediate buffers.
+ *
+ * @return Real time factor of the processing.
+ */
+static double enhance_mapped(
+        pv_koala_t *koala,
+        pv_status_t (*pv_koala_process_func)(pv_koala_t *, const int16_t *, int16_t *),
+        const char *(*pv_status_to_string_func)(pv_status_t),
+        int32_t sample_rate,
+        int32_t frame_length,
+        int32_t delay_samples,
+        const char *input_path,
+        uint64_t data_offset,
+        size_t total_samples,
+        const char *output_path,
+        koala_latency_histogram_t *latency_histogram) {
+    // Samples are handed to the engine straight from the file, so they have to be little-endian `int16_t`s at an
+    // aligned address. Mappings start on a page boundary, hence the alignment only depends on the data offset.
+    const uint16_t endianness_probe = 1;
+    if (*((const uint8_t *) &endianness_probe) != 1) {
+        fprintf(stderr, "memory-mapped processing requires a little-endian host.\n");
+        exit(EXIT_FAILURE);
+    }
+    if ((data_offset % sizeof(int16_t)) != 0) {
+        fprintf(stderr, "data chunk of '%s' is not aligned to a sample boundary.\n", input_path);
+        exit(EXIT_FAILURE);
+    }
+    if (total_samples > ((UINT32_MAX - 36) / sizeof(int16_t))) {
+        fprintf(stderr, "'%s' is too long for a WAV output file.\n", input_path);
+        exit(EXIT_FAILURE);
+    }
+
+    const int input_fd = open(input_path, O_RDONLY);
+    if (input_fd < 0) {
+        fprintf(stderr, "failed to open '%s' with '%s'.\n", input_path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    struct stat input_stat;
+    if (fstat(input_fd, &input_stat) != 0) {
+        fprintf(stderr, "failed to stat '%s' with '%s'.\n", input_path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    const size_t input_size = (size_t) input_stat.st_size;
+    if (input_size < (data_offset + (total_samples * sizeof(int16_t)))) {
+        fprintf(stderr, "'%s' is truncated.\n", input_path);
+        exit(EXIT_FAILURE);
+    }
+
+    uint8_t *input_map = (uint8_t *) mmap(NULL, input_size, PROT_READ, MAP_PRIVATE, input_fd, 0);
+    if (input_map == MAP_FAILED) {
+        fprintf(stderr, "failed to map '%s' with '%s'.\n", input_path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    close(input_fd);
+    madvise(input_map, input_size, MADV_SEQUENTIAL);
+    const int16_t *input = (const int16_t *) (input_map + data_offset);
+
+    const int output_fd = open(output_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (output_fd < 0) {
+        fprintf(stderr, "failed to open the output file at '%s' with '%s'.\n", output_path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    const size_t output_size = WAV_HEADER_SIZE + (total_samples * sizeof(int16_t));
+    if (ftruncate(output_fd, (off_t) output_size) != 0) {
+        fprintf(stderr, "failed to resize '%s' with '%s'.\n", output_path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    uint8_t *output_map = (uint8_t *) mmap(NULL, output_size, PROT_READ | PROT_WRITE, MAP_SHARED, output_fd, 0);
+    if (output_map == MAP_FAILED) {
+        fprintf(stderr, "failed to map '%s' with '%s'.\n", output_path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    close(output_fd);
+    madvise(output_map, output_size, MADV_SEQUENTIAL);
+    write_wav_header(output_map, (uint32_t) total_samples, sample_rate);
+    int16_t *output = (int16_t *) (output_map + WAV_HEADER_SIZE);
+
+    int16_t *pcm = (int16_t *) malloc(frame_length * sizeof(int16_t));
+    if (!pcm) {
+        fprintf(stderr, "Failed to allocate pcm memory.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int16_t *enhanced_pcm = (int16_t *) malloc(frame_length * sizeof(int16_t));
+    if (!enhanced_pcm) {
+        fprintf(stderr, "Failed to allocate enhanced_pcm memory.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    double total_cpu_time_usec = 0;
+    double total_processed_time_usec = 0;
+
+    const size_t end = total_samples + delay_samples;
+    for (size_t start_sample = 0; start_sample < end; start_sample += frame_length) {
+        const size_t end_sample = start_sample + frame_length;
+
+        // The last frames run past the end of the input and are zero-padded in the intermediate buffer.
+        const int16_t *frame = input + start_sample;
+        if (end_sample > total_samples) {
+            memset(pcm, 0, frame_length * sizeof(int16_t));
+            if (start_sample < total_samples) {
+                memcpy(pcm, frame, (total_samples - start_sample) * sizeof(int16_t));
+            }
+            frame = pcm;
+        }
+
+        // Sample `i` of the enhanced frame belongs at `start_sample + i - delay_samples` of the output. Frames that
+        // land entirely inside the output are enhanced in place.
+        const bool is_in_place = (start_sample >= (size_t) delay_samples) && (end_sample <= end);
+        int16_t *enhanced_frame = is_in_place ? (output + (start_sample - delay_samples)) : enhanced_pcm;
+
+        const double before_usec = get_time_usec();
+
+        pv_status_t koala_status = pv_koala_process_func(koala, frame, enhanced_frame);
+        if (koala_status != PV_STATUS_SUCCESS) {
+            fprintf(stderr, "'pv_koala_process' failed with '%s'\n", pv_status_to_string_func(koala_status));
+            exit(EXIT_FAILURE);
+        }
+
+        const double after_usec = get_time_usec();
+
+        total_cpu_time_usec += after_usec - before_usec;
+        total_processed_time_usec += (frame_length * 1e6) / sample_rate;
+        record_latency(latency_histogram, before_usec, after_usec);
+
+        if (!is_in_place && (end_sample > (size_t) delay_samples)) {
+            const size_t copy_start = (start_sample > (size_t) delay_samples) ? start_sample : (size_t) delay_samples;
+            const size_t copy_end = (end_sample < end) ? end_sample : end;
+            memcpy(
+                    output + (copy_start - delay_samples),
+                    enhanced_pcm + (copy_start - start_sample),
+                    (copy_end - copy_start) * sizeof(int16_t));
+        }
+
+        print_progress_bar(total_samples, end_sample);
+    }
+
+    free(pcm);
+    free(enhanced_pcm);
+    munmap(output_map, output_size);
+    munmap(input_map, input_size);
+
+    return total_cpu_time_usec / total_processed_time_usec;
+}
+
+#endif
+
 
 int picovoice_main(int argc, char *argv[]) {
     const char *library_path = NULL;
@@ -116,9 +562,13 @@ int picovoice_main(int argc, char *argv[]) {
     const char *access_key = NULL;
     const char *input_path = NULL;
     const char *output_path = NULL;
+    bool use_mmap = false;
+    bool use_pipeline = false;
+    const char *latency_csv_path = NULL;
+    const char *latency_json_path = NULL;
 
     int c;
-    while ((c = getopt_long(argc, argv, "l:m:a:i:o:", long_options, NULL)) != -1) {
+    while ((c = getopt_long(argc, argv, "l:m:a:i:o:zpc:j:", long_options, NULL)) != -1) {
         switch (c) {
             case 'l':
                 library_path = optarg;
@@ -135,16 +585,37 @@ int picovoice_main(int argc, char *argv[]) {
             case 'o':
                 output_path = optarg;
                 break;
+            case 'z':
+                use_mmap = true;
+                break;
+            case 'p':
+                use_pipeline = true;
+                break;
+            case 'c':
+                latency_csv_path = optarg;
+                break;
+            case 'j':
+                latency_json_path = optarg;
+                break;
             default:
                 exit(EXIT_FAILURE);
         }
     }
 
-    if (!library_path || !access_key || !input_path || !output_path) {
+    if (!library_path || !access_key || !input_path || !output_path || (use_mmap && use_pipeline)) {
         print_usage(argv[0]);
         exit(EXIT_FAILURE);
     }
 
+#if defined(_WIN32) || defined(_WIN64)
+
+    if (use_mmap) {
+        fprintf(stderr, "memory-mapped processing is not supported on Windows.\n");
+        exit(EXIT_FAILURE);
+    }
+
+#endif
+
     void *koala_library = open_dl(library_path);
     if (!koala_library) {
         fprintf(stderr, "failed to open library at '%s'.\n", library_path);
@@ -184,7 +655,7 @@ int picovoice_main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
-    pv_status_t(*pv_koala_delay_sample_func)(pv_koala_t * , int32_t *) =
+    pv_status_t(*pv_koala_delay_sample_func)(const pv_koala_t *, int32_t *) =
             load_symbol(koala_library, "pv_koala_delay_sample");
     if (!pv_koala_delay_sample_func) {
         print_dl_error("failed to load 'pv_koala_delay_sample'");
@@ -246,6 +717,54 @@ int picovoice_main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
+    koala_latency_histogram_t *latency_histogram =
+            (koala_latency_histogram_t *) malloc(sizeof(koala_latency_histogram_t));
+    if (!latency_histogram) {
+        fprintf(stderr, "Failed to allocate latency histogram memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    koala_latency_histogram_init(latency_histogram);
+
+    const int32_t frame_length = pv_koala_frame_length_func();
+    int32_t delay_samples = 0;
+    koala_status = pv_koala_delay_sample_func(koala, &delay_samples);
+    if (koala_status != PV_STATUS_SUCCESS) {
+        fprintf(stderr, "failed to get delay sample with '%s'", pv_status_to_string_func(koala_status));
+        exit(EXIT_FAILURE);
+    }
+
+#if !defined(_WIN32) && !defined(_WIN64)
+
+    if (use_mmap) {
+        fprintf(stdout, "Processing audio...\n");
+
+        const double real_time_factor = enhance_mapped(
+                koala,
+                pv_koala_process_func,
+                pv_status_to_string_func,
+                pv_sample_rate_func(),
+                frame_length,
+                delay_samples,
+                input_path,
+                input_file.dataChunkDataPos,
+                input_file.totalPCMFrameCount,
+                output_path,
+                latency_histogram);
+        fprintf(stdout, "\nreal time factor : %.3f\n", real_time_factor);
+        report_latency(latency_histogram, latency_csv_path, latency_json_path);
+
+        fprintf(stdout, "\n");
+
+        free(latency_histogram);
+        drwav_uninit(&input_file);
+        pv_koala_delete_func(koala);
+        close_dl(koala_library);
+
+        return EXIT_SUCCESS;
+    }
+
+#endif
+
     drwav output_file;
     drwav_data_format format;
     format.container = drwav_container_riff;
@@ -272,12 +791,34 @@ int picovoice_main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
-    const int32_t frame_length = pv_koala_frame_length_func();
-    int32_t delay_samples = 0;
-    koala_status = pv_koala_delay_sample_func(koala, &delay_samples);
-    if (koala_status != PV_STATUS_SUCCESS) {
-        fprintf(stderr, "failed to get delay sample with '%s'", pv_status_to_string_func(koala_status));
-        exit(EXIT_FAILURE);
+    if (use_pipeline) {
+        fprintf(stdout, "Processing audio...\n");
+
+        pipeline_t pipeline;
+        memset(&pipeline, 0, sizeof(pipeline));
+        pipeline.input_file = &input_file;
+        pipeline.output_file = &output_file;
+        pipeline.koala = koala;
+        pipeline.pv_koala_process_func = pv_koala_process_func;
+        pipeline.pv_status_to_string_func = pv_status_to_string_func;
+        pipeline.frame_length = frame_length;
+        pipeline.delay_samples = delay_samples;
+        pipeline.total_samples = input_file.totalPCMFrameCount;
+        pipeline.latency_histogram = latency_histogram;
+
+        const double real_time_factor = enhance_pipelined(&pipeline, pv_sample_rate_func());
+        fprintf(stdout, "\nreal time factor : %.3f\n", real_time_factor);
+        report_latency(latency_histogram, latency_csv_path, latency_json_path);
+
+        fprintf(stdout, "\n");
+
+        drwav_uninit(&output_file);
+        free(latency_histogram);
+        drwav_uninit(&input_file);
+        pv_koala_delete_func(koala);
+        close_dl(koala_library);
+
+        return EXIT_SUCCESS;
     }
 
     int16_t *pcm = (int16_t *) malloc(frame_length * sizeof(int16_t));
@@ -308,8 +849,7 @@ int picovoice_main(int argc, char *argv[]) {
         memset(pcm, 0, frame_length * sizeof(int16_t));
         drwav_read_pcm_frames_s16(&input_file, frame_length, pcm);
 
-        struct timeval before;
-        gettimeofday(&before, NULL);
+        const double before_usec = get_time_usec();
 
         koala_status = pv_koala_process_func(koala, pcm, enhanced_pcm);
         if (koala_status != PV_STATUS_SUCCESS) {
@@ -317,12 +857,11 @@ int picovoice_main(int argc, char *argv[]) {
             exit(EXIT_FAILURE);
         }
 
-        struct timeval after;
-        gettimeofday(&after, NULL);
+        const double after_usec = get_time_usec();
 
-        total_cpu_time_usec +=
-                (double) (after.tv_sec - before.tv_sec) * 1e6 + (double) (after.tv_usec - before.tv_usec);
+        total_cpu_time_usec += after_usec - before_usec;
         total_processed_time_usec += (frame_length * 1e6) / pv_sample_rate_func();
+        record_latency(latency_histogram, before_usec, after_usec);
 
         pcm_to_write = enhanced_pcm;
         pcm_to_write_length = frame_length;
@@ -348,11 +887,13 @@ int picovoice_main(int argc, char *argv[]) {
 
     const double real_time_factor = total_cpu_time_usec / total_processed_time_usec;
     fprintf(stdout, "\nreal time factor : %.3f\n", real_time_factor);
+    report_latency(latency_histogram, latency_csv_path, latency_json_path);
 
     fprintf(stdout, "\n");
 
     free(pcm);
     free(enhanced_pcm);
+    free(latency_histogram);
     drwav_uninit(&output_file);
     drwav_uninit(&input_file);
     pv_koala_delete_func(koala);
@@ -9,13 +9,25 @@
     specific language governing permissions and limitations under the License.
 */
 
+#if defined(__linux__)
+
+// Needed for CPU pinning in `koala_realtime.h`.
+#define _GNU_SOURCE
+
+#endif
+
 #include <float.h>
 #include <getopt.h>
+#include <inttypes.h>
 #include <limits.h>
 #include <math.h>
+#include <pthread.h>
 #include <signal.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #if defined(_WIN32) || defined(_WIN64)
 
@@ -35,6 +47,9 @@
 #include "pv_koala.h"
 #include "pv_recorder.h"
 
+#include "koala_realtime.h"
+#include "koala_ring_buffer.h"
+
 static void *open_dl(const char *dl_path) {
 
 #if defined(_WIN32) || defined(_WIN64)
@@ -101,14 +116,27 @@ static struct option long_options[] = {
         {"output_audio_path",    required_argument, NULL, 'o'},
         {"reference_audio_path", no_argument,       NULL, 'r'},
         {"show_audio_devices",   no_argument,       NULL, 's'},
+        {"realtime_priority",    required_argument, NULL, 'p'},
+        {"cpu_index",            required_argument, NULL, 'c'},
+        {"lock_memory",          no_argument,       NULL, 'L'},
+        {NULL,                   0,                 NULL, 0},
 };
 
 void print_usage(const char *program_name) {
     fprintf(stdout,
-            "Usage: %s [-s] [-l LIBRARY_PATH -m MODEL_PATH -a ACCESS_KEY -d AUDIO_DEVICE_INDEX -o WAV_OUTPUT_PATH -r WAV_REFERENCE_PATH]\n",
+            "Usage: %s [-s] [-l LIBRARY_PATH -m MODEL_PATH -a ACCESS_KEY -d AUDIO_DEVICE_INDEX -o WAV_OUTPUT_PATH -r WAV_REFERENCE_PATH] "
+            "[-p REALTIME_PRIORITY] [-c CPU_INDEX] [-L]\n",
             program_name);
 }
 
+static void print_realtime_status(const char *setting, int error) {
+    if (error == 0) {
+        fprintf(stdout, "%s : applied\n", setting);
+    } else {
+        fprintf(stdout, "%s : not applied (%s)\n", setting, strerror(error));
+    }
+}
+
 void interrupt_handler(int _) {
     (void) _;
     is_interrupted = true;
@@ -151,6 +179,178 @@ static void print_vu_meter(const int16_t *pcm_buffer, int32_t num_samples) {
     fflush(stdout);
 }
 
+static double get_time_usec(void) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    static LARGE_INTEGER frequency = {0};
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (double) counter.QuadPart * 1e6 / (double) frequency.QuadPart;
+
+#else
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec * 1e6 + (double) now.tv_nsec * 1e-3;
+
+#endif
+}
+
+// A frame lasts 16 ms, so polling an empty queue every millisecond adds little latency and keeps the idle threads off
+// the CPU.
+static void wait_for_frame(void) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    Sleep(1);
+
+#else
+
+    const struct timespec duration = {0, 1000000};
+    nanosleep(&duration, NULL);
+
+#endif
+
+}
+
+// 64 frames of 256 samples buffer about a second of audio between two threads.
+#define NUM_QUEUE_SLOTS (64)
+
+/**
+ * A captured frame travelling through the queues. `samples` holds the captured audio, followed by its enhanced version
+ * once it has been through Koala.
+ */
+typedef struct {
+    double captured_usec;
+    int16_t samples[];
+} frame_slot_t;
+
+/**
+ * State shared by the capture (main), enhance and write threads. The capture thread never waits: when the capture
+ * queue is full it keeps draining the recorder and drops the frame. The enhance thread likewise drops enhanced frames
+ * when the write queue is full, but still runs them through Koala to keep its state continuous. Each counter is
+ * written by a single thread and read by the main thread after the others have been joined.
+ */
+typedef struct {
+    pv_koala_t *koala;
+    pv_status_t (*pv_koala_process_func)(pv_koala_t *, const int16_t *, int16_t *);
+    const char *(*pv_status_to_string_func)(pv_status_t);
+    int32_t frame_length;
+    drwav *output_file;
+    drwav *reference_file;
+    int16_t *discarded_pcm;
+    koala_ring_buffer_t capture_queue;
+    koala_ring_buffer_t write_queue;
+    bool is_capture_done;
+    bool is_enhance_done;
+    uint64_t num_frames_captured;
+    uint64_t num_frames_dropped_capture;
+    uint64_t num_frames_dropped_write;
+    uint32_t capture_queue_high_water_mark;
+    uint32_t write_queue_high_water_mark;
+    double max_enhance_latency_usec;
+    double max_write_latency_usec;
+} mic_pipeline_t;
+
+static void *enhance_thread(void *arg) {
+    mic_pipeline_t *pipeline = (mic_pipeline_t *) arg;
+    const int32_t frame_length = pipeline->frame_length;
+
+    while (true) {
+        const bool is_capture_done = __atomic_load_n(&pipeline->is_capture_done, __ATOMIC_ACQUIRE);
+        frame_slot_t *captured = (frame_slot_t *) koala_ring_buffer_acquire_read(&pipeline->capture_queue);
+        if (!captured) {
+            if (is_capture_done) {
+                break;
+            }
+            wait_for_frame();
+            continue;
+        }
+
+        frame_slot_t *enhanced = (frame_slot_t *) koala_ring_buffer_acquire_write(&pipeline->write_queue);
+        int16_t *enhanced_pcm = enhanced ? (enhanced->samples + frame_length) : pipeline->discarded_pcm;
+
+        pv_status_t koala_status = pipeline->pv_koala_process_func(pipeline->koala, captured->samples, enhanced_pcm);
+        if (koala_status != PV_STATUS_SUCCESS) {
+            fprintf(
+                    stderr,
+                    "'pv_koala_process' failed with '%s'\n",
+                    pipeline->pv_status_to_string_func(koala_status));
+            exit(EXIT_FAILURE);
+        }
+
+        const double latency_usec = get_time_usec() - captured->captured_usec;
+        if (latency_usec > pipeline->max_enhance_latency_usec) {
+            pipeline->max_enhance_latency_usec = latency_usec;
+        }
+
+        if (enhanced) {
+            enhanced->captured_usec = captured->captured_usec;
+            memcpy(enhanced->samples, captured->samples, frame_length * sizeof(int16_t));
+            koala_ring_buffer_commit_write(&pipeline->write_queue);
+
+            const uint32_t queue_size = koala_ring_buffer_size(&pipeline->write_queue);
+            if (queue_size > pipeline->write_queue_high_water_mark) {
+                pipeline->write_queue_high_water_mark = queue_size;
+            }
+        } else {
+            pipeline->num_frames_dropped_write++;
+        }
+
+        koala_ring_buffer_release_read(&pipeline->capture_queue);
+    }
+
+    __atomic_store_n(&pipeline->is_enhance_done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void *write_thread(void *arg) {
+    mic_pipeline_t *pipeline = (mic_pipeline_t *) arg;
+    const int32_t frame_length = pipeline->frame_length;
+
+    while (true) {
+        const bool is_enhance_done = __atomic_load_n(&pipeline->is_enhance_done, __ATOMIC_ACQUIRE);
+        const frame_slot_t *frame = (const frame_slot_t *) koala_ring_buffer_acquire_read(&pipeline->write_queue);
+        if (!frame) {
+            if (is_enhance_done) {
+                break;
+            }
+            wait_for_frame();
+            continue;
+        }
+
+        const int16_t *pcm = frame->samples;
+        const int16_t *enhanced_pcm = frame->samples + frame_length;
+
+        if ((int32_t) drwav_write_pcm_frames(pipeline->output_file, frame_length, enhanced_pcm) != frame_length) {
+            fprintf(stderr, "Failed to write to wav file.\n");
+            exit(EXIT_FAILURE);
+        }
+
+        if (pipeline->reference_file) {
+            if ((int32_t) drwav_write_pcm_frames(pipeline->reference_file, frame_length, pcm) != frame_length) {
+                fprintf(stderr, "Failed to write to reference wav file.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        const double latency_usec = get_time_usec() - frame->captured_usec;
+        if (latency_usec > pipeline->max_write_latency_usec) {
+            pipeline->max_write_latency_usec = latency_usec;
+        }
+
+        print_vu_meter(pcm, frame_length);
+
+        koala_ring_buffer_release_read(&pipeline->write_queue);
+    }
+
+    return NULL;
+}
+
 int picovoice_main(int argc, char *argv[]) {
     signal(SIGINT, interrupt_handler);
 
@@ -160,9 +360,12 @@ int picovoice_main(int argc, char *argv[]) {
     const char *reference_path = NULL;
     const char *model_path = NULL;
     int32_t device_index = -1;
+    int32_t realtime_priority = -1;
+    int32_t cpu_index = -1;
+    bool lock_memory = false;
 
     int c;
-    while ((c = getopt_long(argc, argv, "hsl:a:d:o:m:r:", long_options, NULL)) != -1) {
+    while ((c = getopt_long(argc, argv, "hsl:a:d:o:m:r:p:c:L", long_options, NULL)) != -1) {
         switch (c) {
             case 's':
                 show_audio_devices();
@@ -185,6 +388,15 @@ int picovoice_main(int argc, char *argv[]) {
             case 'd':
                 device_index = (int32_t) strtol(optarg, NULL, 10);
                 break;
+            case 'p':
+                realtime_priority = (int32_t) strtol(optarg, NULL, 10);
+                break;
+            case 'c':
+                cpu_index = (int32_t) strtol(optarg, NULL, 10);
+                break;
+            case 'L':
+                lock_memory = true;
+                break;
             default:
                 exit(EXIT_FAILURE);
         }
@@ -335,35 +547,101 @@ int picovoice_main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
+    mic_pipeline_t pipeline;
+    memset(&pipeline, 0, sizeof(pipeline));
+    pipeline.koala = koala;
+    pipeline.pv_koala_process_func = pv_koala_process_func;
+    pipeline.pv_status_to_string_func = pv_status_to_string_func;
+    pipeline.frame_length = frame_length;
+    pipeline.output_file = &output_file;
+    pipeline.reference_file = reference_path ? &reference_file : NULL;
+    pipeline.discarded_pcm = enhanced_pcm;
+
+    // Slots carry the captured frame and room for its enhanced version, padded so `captured_usec` stays aligned.
+    size_t slot_size = sizeof(frame_slot_t) + (2 * frame_length * sizeof(int16_t));
+    slot_size = (slot_size + sizeof(double) - 1) / sizeof(double) * sizeof(double);
+    if (!koala_ring_buffer_init(&pipeline.capture_queue, slot_size, NUM_QUEUE_SLOTS) ||
+        !koala_ring_buffer_init(&pipeline.write_queue, slot_size, NUM_QUEUE_SLOTS)) {
+        fprintf(stderr, "Failed to allocate queue memory.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Everything the audio path needs is allocated by now. `MCL_FUTURE` also covers the stacks of the threads below.
+    if (lock_memory) {
+        print_realtime_status("memory lock", koala_realtime_lock_memory());
+    }
+
+    pthread_t enhance_thread_handle;
+    if (pthread_create(&enhance_thread_handle, NULL, enhance_thread, &pipeline) != 0) {
+        fprintf(stderr, "Failed to start the enhance thread.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (realtime_priority >= 0) {
+        char setting[64];
+        snprintf(setting, sizeof(setting), "SCHED_FIFO priority %d", realtime_priority);
+        print_realtime_status(setting, koala_realtime_set_fifo_priority(enhance_thread_handle, realtime_priority));
+    }
+
+    if (cpu_index >= 0) {
+        char setting[64];
+        snprintf(setting, sizeof(setting), "pinning to CPU %d", cpu_index);
+        print_realtime_status(setting, koala_realtime_pin_to_cpu(enhance_thread_handle, cpu_index));
+    }
+
+    pthread_t write_thread_handle;
+    if (pthread_create(&write_thread_handle, NULL, write_thread, &pipeline) != 0) {
+        fprintf(stderr, "Failed to start the write thread.\n");
+        exit(EXIT_FAILURE);
+    }
+
     while (!is_interrupted) {
-        recorder_status = pv_recorder_read(recorder, pcm);
+        frame_slot_t *slot = (frame_slot_t *) koala_ring_buffer_acquire_write(&pipeline.capture_queue);
+        int16_t *captured_pcm = slot ? slot->samples : pcm;
+
+        recorder_status = pv_recorder_read(recorder, captured_pcm);
         if (recorder_status != PV_RECORDER_STATUS_SUCCESS) {
             fprintf(stderr, "Failed to read with %s.\n", pv_recorder_status_to_string(recorder_status));
             exit(EXIT_FAILURE);
         }
+        pipeline.num_frames_captured++;
 
-        koala_status = pv_koala_process_func(koala, pcm, enhanced_pcm);
-        if (koala_status != PV_STATUS_SUCCESS) {
-            fprintf(stderr, "'pv_koala_process' failed with '%s'\n", pv_status_to_string_func(koala_status));
-            exit(EXIT_FAILURE);
-        }
-
-        if ((int32_t) drwav_write_pcm_frames(&output_file, frame_length, enhanced_pcm) != frame_length) {
-            fprintf(stderr, "Failed to write to wav file.\n");
-            exit(EXIT_FAILURE);
-        }
+        if (slot) {
+            slot->captured_usec = get_time_usec();
+            koala_ring_buffer_commit_write(&pipeline.capture_queue);
 
-        if (reference_path) {
-            if ((int32_t) drwav_write_pcm_frames(&reference_file, frame_length, pcm) != frame_length) {
-                fprintf(stderr, "Failed to write to reference wav file.\n");
-                exit(EXIT_FAILURE);
+            const uint32_t queue_size = koala_ring_buffer_size(&pipeline.capture_queue);
+            if (queue_size > pipeline.capture_queue_high_water_mark) {
+                pipeline.capture_queue_high_water_mark = queue_size;
             }
+        } else {
+            pipeline.num_frames_dropped_capture++;
         }
-
-        print_vu_meter(pcm, frame_length);
     }
+
+    __atomic_store_n(&pipeline.is_capture_done, true, __ATOMIC_RELEASE);
+    pthread_join(enhance_thread_handle, NULL);
+    pthread_join(write_thread_handle, NULL);
+    fprintf(stdout, "\n\n");
+
+    fprintf(stdout, "frames captured             : %" PRIu64 "\n", pipeline.num_frames_captured);
+    fprintf(stdout, "frames dropped before koala : %" PRIu64 "\n", pipeline.num_frames_dropped_capture);
+    fprintf(stdout, "frames dropped before disk  : %" PRIu64 "\n", pipeline.num_frames_dropped_write);
+    fprintf(stdout,
+            "capture queue high-water    : %u / %d frames\n",
+            pipeline.capture_queue_high_water_mark,
+            NUM_QUEUE_SLOTS);
+    fprintf(stdout,
+            "write queue high-water      : %u / %d frames\n",
+            pipeline.write_queue_high_water_mark,
+            NUM_QUEUE_SLOTS);
+    fprintf(stdout, "worst latency to enhanced   : %.2f ms\n", pipeline.max_enhance_latency_usec * 1e-3);
+    fprintf(stdout, "worst latency to disk       : %.2f ms\n", pipeline.max_write_latency_usec * 1e-3);
     fprintf(stdout, "\n");
 
+    koala_ring_buffer_free(&pipeline.capture_queue);
+    koala_ring_buffer_free(&pipeline.write_queue);
+
     recorder_status = pv_recorder_stop(recorder);
     if (recorder_status != PV_RECORDER_STATUS_SUCCESS) {
         fprintf(stderr, "Failed to stop device with %s.\n", pv_recorder_status_to_string(recorder_status));
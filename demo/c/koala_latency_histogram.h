@@ -0,0 +1,199 @@
+/*
+    Copyright 2023 Picovoice Inc.
+    You may not use this file except in compliance with the license. A copy of the license is located in the "LICENSE"
+    file accompanying this source.
+    Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+    an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the
+    specific language governing permissions and limitations under the License.
+*/
+
+#ifndef KOALA_LATENCY_HISTOGRAM_H
+#define KOALA_LATENCY_HISTOGRAM_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Fixed-size log-linear histogram of latencies in nanoseconds, in the spirit of HdrHistogram. Values below
+ * `2^KOALA_HISTOGRAM_SUB_BUCKET_BITS` get a bucket each; above that, every power-of-two range is split into
+ * `2^KOALA_HISTOGRAM_SUB_BUCKET_BITS` equal buckets, so any recorded value is known to within about 1.6%. Recording is
+ * a handful of integer operations with no allocation, cheap enough to run around every `pv_koala_process` call.
+ *
+ * Values of `2^(KOALA_HISTOGRAM_MAX_MAGNITUDE + 1)` nanoseconds (about 37 minutes) and above are clamped into the last
+ * bucket; the exact maximum is still kept in `max_value`. A histogram must only be recorded into by one thread at a
+ * time.
+ */
+
+#define KOALA_HISTOGRAM_SUB_BUCKET_BITS (6)
+#define KOALA_HISTOGRAM_SUB_BUCKET_COUNT (1 << KOALA_HISTOGRAM_SUB_BUCKET_BITS)
+#define KOALA_HISTOGRAM_MAX_MAGNITUDE (40)
+#define KOALA_HISTOGRAM_NUM_BUCKETS \
+    ((KOALA_HISTOGRAM_MAX_MAGNITUDE - KOALA_HISTOGRAM_SUB_BUCKET_BITS + 2) * KOALA_HISTOGRAM_SUB_BUCKET_COUNT)
+
+typedef struct {
+    uint64_t counts[KOALA_HISTOGRAM_NUM_BUCKETS];
+    uint64_t total_count;
+    uint64_t min_value;
+    uint64_t max_value;
+} koala_latency_histogram_t;
+
+static inline void koala_latency_histogram_init(koala_latency_histogram_t *histogram) {
+    memset(histogram, 0, sizeof(*histogram));
+    histogram->min_value = UINT64_MAX;
+}
+
+static inline int32_t koala_latency_histogram_bucket_index(uint64_t value) {
+    if (value < KOALA_HISTOGRAM_SUB_BUCKET_COUNT) {
+        return (int32_t) value;
+    }
+
+    int32_t magnitude = 63 - __builtin_clzll(value);
+    if (magnitude > KOALA_HISTOGRAM_MAX_MAGNITUDE) {
+        return KOALA_HISTOGRAM_NUM_BUCKETS - 1;
+    }
+
+    const int32_t shift = magnitude - KOALA_HISTOGRAM_SUB_BUCKET_BITS;
+    const int32_t sub_bucket = (int32_t) ((value >> shift) & (KOALA_HISTOGRAM_SUB_BUCKET_COUNT - 1));
+    return ((shift + 1) << KOALA_HISTOGRAM_SUB_BUCKET_BITS) + sub_bucket;
+}
+
+static inline uint64_t koala_latency_histogram_bucket_lower(int32_t index) {
+    if (index < KOALA_HISTOGRAM_SUB_BUCKET_COUNT) {
+        return (uint64_t) index;
+    }
+
+    const int32_t shift = (index >> KOALA_HISTOGRAM_SUB_BUCKET_BITS) - 1;
+    const uint64_t sub_bucket = (uint64_t) (index & (KOALA_HISTOGRAM_SUB_BUCKET_COUNT - 1));
+    return (KOALA_HISTOGRAM_SUB_BUCKET_COUNT + sub_bucket) << shift;
+}
+
+/**
+ * Largest value that falls into the bucket at `index`.
+ */
+static inline uint64_t koala_latency_histogram_bucket_upper(int32_t index) {
+    if (index < KOALA_HISTOGRAM_SUB_BUCKET_COUNT) {
+        return (uint64_t) index;
+    }
+
+    const int32_t shift = (index >> KOALA_HISTOGRAM_SUB_BUCKET_BITS) - 1;
+    return koala_latency_histogram_bucket_lower(index) + (((uint64_t) 1) << shift) - 1;
+}
+
+static inline void koala_latency_histogram_record(koala_latency_histogram_t *histogram, uint64_t value) {
+    histogram->counts[koala_latency_histogram_bucket_index(value)]++;
+    histogram->total_count++;
+    if (value < histogram->min_value) {
+        histogram->min_value = value;
+    }
+    if (value > histogram->max_value) {
+        histogram->max_value = value;
+    }
+}
+
+/**
+ * Adds the samples of `other` to `histogram`, e.g. to combine per-thread histograms once the threads are done.
+ */
+static inline void koala_latency_histogram_merge(
+        koala_latency_histogram_t *histogram,
+        const koala_latency_histogram_t *other) {
+    for (int32_t i = 0; i < KOALA_HISTOGRAM_NUM_BUCKETS; i++) {
+        histogram->counts[i] += other->counts[i];
+    }
+    histogram->total_count += other->total_count;
+    if (other->min_value < histogram->min_value) {
+        histogram->min_value = other->min_value;
+    }
+    if (other->max_value > histogram->max_value) {
+        histogram->max_value = other->max_value;
+    }
+}
+
+/**
+ * Value at or below which `percentile` percent of the samples fall. Returns the upper end of the bucket holding that
+ * sample, capped at the exact maximum, so the result never understates the latency. Returns `0` for an empty histogram.
+ */
+static inline uint64_t koala_latency_histogram_percentile(
+        const koala_latency_histogram_t *histogram,
+        double percentile) {
+    if (histogram->total_count == 0) {
+        return 0;
+    }
+
+    uint64_t target = (uint64_t) ((percentile / 100.) * (double) histogram->total_count + 0.5);
+    if (target < 1) {
+        target = 1;
+    }
+    if (target > histogram->total_count) {
+        target = histogram->total_count;
+    }
+
+    uint64_t cumulative_count = 0;
+    for (int32_t i = 0; i < KOALA_HISTOGRAM_NUM_BUCKETS; i++) {
+        cumulative_count += histogram->counts[i];
+        if (cumulative_count >= target) {
+            const uint64_t upper = koala_latency_histogram_bucket_upper(i);
+            return (upper < histogram->max_value) ? upper : histogram->max_value;
+        }
+    }
+
+    return histogram->max_value;
+}
+
+/**
+ * Writes the non-empty buckets as CSV rows of `lower_nsec,upper_nsec,count,cumulative_percentile`.
+ */
+static inline void koala_latency_histogram_write_csv(const koala_latency_histogram_t *histogram, FILE *f) {
+    fprintf(f, "lower_nsec,upper_nsec,count,cumulative_percentile\n");
+
+    uint64_t cumulative_count = 0;
+    for (int32_t i = 0; i < KOALA_HISTOGRAM_NUM_BUCKETS; i++) {
+        if (histogram->counts[i] == 0) {
+            continue;
+        }
+        cumulative_count += histogram->counts[i];
+        fprintf(f,
+                "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%.4f\n",
+                koala_latency_histogram_bucket_lower(i),
+                koala_latency_histogram_bucket_upper(i),
+                histogram->counts[i],
+                100. * (double) cumulative_count / (double) histogram->total_count);
+    }
+}
+
+/**
+ * Writes a JSON object with the sample count, minimum, the usual percentiles, maximum and the non-empty buckets.
+ */
+static inline void koala_latency_histogram_write_json(const koala_latency_histogram_t *histogram, FILE *f) {
+    const uint64_t min_value = (histogram->total_count > 0) ? histogram->min_value : 0;
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"count\": %" PRIu64 ",\n", histogram->total_count);
+    fprintf(f, "  \"min_nsec\": %" PRIu64 ",\n", min_value);
+    fprintf(f, "  \"p50_nsec\": %" PRIu64 ",\n", koala_latency_histogram_percentile(histogram, 50.));
+    fprintf(f, "  \"p90_nsec\": %" PRIu64 ",\n", koala_latency_histogram_percentile(histogram, 90.));
+    fprintf(f, "  \"p99_nsec\": %" PRIu64 ",\n", koala_latency_histogram_percentile(histogram, 99.));
+    fprintf(f, "  \"p99_9_nsec\": %" PRIu64 ",\n", koala_latency_histogram_percentile(histogram, 99.9));
+    fprintf(f, "  \"max_nsec\": %" PRIu64 ",\n", histogram->max_value);
+    fprintf(f, "  \"buckets\": [");
+
+    bool is_first = true;
+    for (int32_t i = 0; i < KOALA_HISTOGRAM_NUM_BUCKETS; i++) {
+        if (histogram->counts[i] == 0) {
+            continue;
+        }
+        fprintf(f,
+                "%s\n    {\"lower_nsec\": %" PRIu64 ", \"upper_nsec\": %" PRIu64 ", \"count\": %" PRIu64 "}",
+                is_first ? "" : ",",
+                koala_latency_histogram_bucket_lower(i),
+                koala_latency_histogram_bucket_upper(i),
+                histogram->counts[i]);
+        is_first = false;
+    }
+
+    fprintf(f, "\n  ]\n}\n");
+}
+
+#endif // KOALA_LATENCY_HISTOGRAM_H
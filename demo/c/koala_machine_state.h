@@ -0,0 +1,227 @@
+/*
+    Copyright 2023 Picovoice Inc.
+    You may not use this file except in compliance with the license. A copy of the license is located in the "LICENSE"
+    file accompanying this source.
+    Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+    an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the
+    specific language governing permissions and limitations under the License.
+*/
+
+#ifndef KOALA_MACHINE_STATE_H
+#define KOALA_MACHINE_STATE_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Snapshot of the machine conditions that skew benchmark numbers: CPU frequency, temperature, load and throttling.
+ * Samples are read from sysfs and procfs on Linux; fields that cannot be read on the current machine are flagged as
+ * unavailable, and on other platforms every field is. The same fields are written by `test_koala_perf.py`, so results
+ * from both runners can be compared side by side.
+ *
+ * Throttling is detected from two sources: the per-core `thermal_throttle` counters of x86 kernels, and the firmware
+ * `get_throttled` flags of Raspberry Pi kernels (the value printed by `vcgencmd get_throttled`).
+ */
+
+#define KOALA_MACHINE_STATE_MAX_SAMPLES (32)
+
+// Raspberry Pi firmware flags: frequency capped, currently throttled, soft temperature limit active.
+#define KOALA_MACHINE_STATE_PI_THROTTLED_NOW (0x0000E)
+// The same three conditions, latched since boot.
+#define KOALA_MACHINE_STATE_PI_THROTTLED_SINCE_BOOT (0xE0000)
+
+typedef struct {
+    double elapsed_sec;
+    bool has_cpu_frequency;
+    double min_cpu_frequency_mhz;
+    double mean_cpu_frequency_mhz;
+    bool has_temperature;
+    double max_temperature_celsius;
+    bool has_load_average;
+    double load_average;
+    bool has_throttle_count;
+    uint64_t throttle_count;
+    bool has_throttled_flags;
+    uint32_t throttled_flags;
+} koala_machine_state_t;
+
+static inline bool koala_machine_state_read_file(const char *path, char *buffer, size_t buffer_size) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    const size_t length = fread(buffer, 1, buffer_size - 1, f);
+    fclose(f);
+    buffer[length] = '\0';
+    return length > 0;
+}
+
+/**
+ * Reads the current state of the machine. `elapsed_sec` is stored as is, to place the sample on the timeline of a run.
+ */
+static inline void koala_machine_state_sample(koala_machine_state_t *state, double elapsed_sec) {
+    memset(state, 0, sizeof(*state));
+    state->elapsed_sec = elapsed_sec;
+
+#if defined(__linux__)
+
+    char path[256];
+    char buffer[256];
+
+    int32_t num_cpus = 0;
+    double total_mhz = 0.;
+    uint64_t throttle_count = 0;
+    for (int32_t cpu = 0; cpu < 1024; cpu++) {
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_cur_freq", cpu);
+        if (koala_machine_state_read_file(path, buffer, sizeof(buffer))) {
+            const double mhz = strtod(buffer, NULL) * 1e-3;
+            if ((num_cpus == 0) || (mhz < state->min_cpu_frequency_mhz)) {
+                state->min_cpu_frequency_mhz = mhz;
+            }
+            total_mhz += mhz;
+            num_cpus++;
+        }
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/thermal_throttle/core_throttle_count", cpu);
+        if (koala_machine_state_read_file(path, buffer, sizeof(buffer))) {
+            throttle_count += strtoull(buffer, NULL, 10);
+            state->has_throttle_count = true;
+        }
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+        FILE *f = fopen(path, "r");
+        if (!f) {
+            break;
+        }
+        fclose(f);
+    }
+    if (num_cpus > 0) {
+        state->has_cpu_frequency = true;
+        state->mean_cpu_frequency_mhz = total_mhz / num_cpus;
+    }
+    state->throttle_count = throttle_count;
+
+    for (int32_t zone = 0; zone < 64; zone++) {
+        snprintf(path, sizeof(path), "/sys/class/thermal/thermal_zone%d/temp", zone);
+        if (!koala_machine_state_read_file(path, buffer, sizeof(buffer))) {
+            break;
+        }
+        const double celsius = strtod(buffer, NULL) * 1e-3;
+        if (!state->has_temperature || (celsius > state->max_temperature_celsius)) {
+            state->max_temperature_celsius = celsius;
+        }
+        state->has_temperature = true;
+    }
+
+    if (koala_machine_state_read_file("/proc/loadavg", buffer, sizeof(buffer))) {
+        state->load_average = strtod(buffer, NULL);
+        state->has_load_average = true;
+    }
+
+    if (koala_machine_state_read_file("/sys/devices/platform/soc/soc:firmware/get_throttled", buffer, sizeof(buffer))) {
+        state->throttled_flags = (uint32_t) strtoul(buffer, NULL, 16);
+        state->has_throttled_flags = true;
+    }
+
+#endif
+
+}
+
+/**
+ * Returns `true` if the CPU was throttled at any point between the first and the last of `samples`.
+ */
+static inline bool koala_machine_state_throttled(const koala_machine_state_t *samples, int32_t num_samples) {
+    if (num_samples < 1) {
+        return false;
+    }
+
+    const koala_machine_state_t *first = &samples[0];
+    const koala_machine_state_t *last = &samples[num_samples - 1];
+
+    if (first->has_throttle_count && last->has_throttle_count && (last->throttle_count > first->throttle_count)) {
+        return true;
+    }
+
+    for (int32_t i = 0; i < num_samples; i++) {
+        if (samples[i].has_throttled_flags && (samples[i].throttled_flags & KOALA_MACHINE_STATE_PI_THROTTLED_NOW)) {
+            return true;
+        }
+    }
+
+    if (first->has_throttled_flags && last->has_throttled_flags) {
+        const uint32_t latched = last->throttled_flags & ~first->throttled_flags;
+        if (latched & KOALA_MACHINE_STATE_PI_THROTTLED_SINCE_BOOT) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static inline void koala_machine_state_write_json_value(FILE *f, bool is_available, const char *format, double value) {
+    if (is_available) {
+        fprintf(f, format, value);
+    } else {
+        fprintf(f, "null");
+    }
+}
+
+static inline void koala_machine_state_write_sample_json(const koala_machine_state_t *state, FILE *f) {
+    fprintf(f, "{\"elapsed_sec\": %.3f, \"min_cpu_frequency_mhz\": ", state->elapsed_sec);
+    koala_machine_state_write_json_value(f, state->has_cpu_frequency, "%.1f", state->min_cpu_frequency_mhz);
+    fprintf(f, ", \"mean_cpu_frequency_mhz\": ");
+    koala_machine_state_write_json_value(f, state->has_cpu_frequency, "%.1f", state->mean_cpu_frequency_mhz);
+    fprintf(f, ", \"max_temperature_celsius\": ");
+    koala_machine_state_write_json_value(f, state->has_temperature, "%.1f", state->max_temperature_celsius);
+    fprintf(f, ", \"load_average\": ");
+    koala_machine_state_write_json_value(f, state->has_load_average, "%.2f", state->load_average);
+    fprintf(f, ", \"throttle_count\": ");
+    koala_machine_state_write_json_value(f, state->has_throttle_count, "%.0f", (double) state->throttle_count);
+    fprintf(f, ", \"throttled_flags\": ");
+    koala_machine_state_write_json_value(f, state->has_throttled_flags, "%.0f", (double) state->throttled_flags);
+    fprintf(f, "}");
+}
+
+/**
+ * Writes `samples` as a JSON object holding the first sample as `before`, the last as `after`, the ones in between as
+ * `during`, and whether the run throttled. `indent` is prepended to every line after the first.
+ */
+static inline void koala_machine_state_write_json(
+        const koala_machine_state_t *samples,
+        int32_t num_samples,
+        const char *indent,
+        FILE *f) {
+    fprintf(f, "{\n%s  \"before\": ", indent);
+    if (num_samples > 0) {
+        koala_machine_state_write_sample_json(&samples[0], f);
+    } else {
+        fprintf(f, "null");
+    }
+
+    fprintf(f, ",\n%s  \"during\": [", indent);
+    for (int32_t i = 1; i < num_samples - 1; i++) {
+        fprintf(f, "%s\n%s    ", (i == 1) ? "" : ",", indent);
+        koala_machine_state_write_sample_json(&samples[i], f);
+    }
+    if (num_samples > 2) {
+        fprintf(f, "\n%s  ", indent);
+    }
+    fprintf(f, "],\n%s  \"after\": ", indent);
+    if (num_samples > 1) {
+        koala_machine_state_write_sample_json(&samples[num_samples - 1], f);
+    } else {
+        fprintf(f, "null");
+    }
+
+    fprintf(f,
+            ",\n%s  \"throttled\": %s\n%s}",
+            indent,
+            koala_machine_state_throttled(samples, num_samples) ? "true" : "false",
+            indent);
+}
+
+#endif // KOALA_MACHINE_STATE_H
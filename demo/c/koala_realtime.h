@@ -0,0 +1,102 @@
+/*
+    Copyright 2023 Picovoice Inc.
+    You may not use this file except in compliance with the license. A copy of the license is located in the "LICENSE"
+    file accompanying this source.
+    Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+    an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the
+    specific language governing permissions and limitations under the License.
+*/
+
+#ifndef KOALA_REALTIME_H
+#define KOALA_REALTIME_H
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+
+#include <sched.h>
+#include <sys/mman.h>
+
+#endif
+
+/**
+ * Helpers for running the thread that calls `pv_koala_process` under real-time conditions. Each returns `0` on success
+ * or an `errno` value describing why the setting could not be applied, which callers can report with `strerror()`.
+ * Settings that the platform does not offer return `ENOSYS`.
+ *
+ * CPU pinning is only available on Linux, and requires `_GNU_SOURCE` to be defined before the first system include of
+ * the including file.
+ */
+
+/**
+ * Switches `thread` to the `SCHED_FIFO` policy at `priority`. Usually needs root or `CAP_SYS_NICE`.
+ */
+static inline int koala_realtime_set_fifo_priority(pthread_t thread, int32_t priority) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    (void) thread;
+    (void) priority;
+    return ENOSYS;
+
+#else
+
+    if ((priority < sched_get_priority_min(SCHED_FIFO)) || (priority > sched_get_priority_max(SCHED_FIFO))) {
+        return EINVAL;
+    }
+
+    struct sched_param param;
+    param.sched_priority = priority;
+    return pthread_setschedparam(thread, SCHED_FIFO, &param);
+
+#endif
+
+}
+
+/**
+ * Restricts `thread` to the CPU at `cpu_index`. Works best on a core kept free of other work, e.g. with `isolcpus`.
+ */
+static inline int koala_realtime_pin_to_cpu(pthread_t thread, int32_t cpu_index) {
+
+#if defined(__linux__) && defined(_GNU_SOURCE)
+
+    if ((cpu_index < 0) || (cpu_index >= CPU_SETSIZE)) {
+        return EINVAL;
+    }
+
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu_index, &cpu_set);
+    return pthread_setaffinity_np(thread, sizeof(cpu_set), &cpu_set);
+
+#else
+
+    (void) thread;
+    (void) cpu_index;
+    return ENOSYS;
+
+#endif
+
+}
+
+/**
+ * Locks all current and future pages of the process into RAM so the audio path never takes a page fault. Usually
+ * needs root, `CAP_IPC_LOCK` or a large enough `RLIMIT_MEMLOCK`.
+ */
+static inline int koala_realtime_lock_memory(void) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    return ENOSYS;
+
+#else
+
+    return (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) ? 0 : errno;
+
+#endif
+
+}
+
+#endif // KOALA_REALTIME_H
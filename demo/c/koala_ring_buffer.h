@@ -0,0 +1,112 @@
+/*
+    Copyright 2023 Picovoice Inc.
+    You may not use this file except in compliance with the license. A copy of the license is located in the "LICENSE"
+    file accompanying this source.
+    Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+    an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the
+    specific language governing permissions and limitations under the License.
+*/
+
+#ifndef KOALA_RING_BUFFER_H
+#define KOALA_RING_BUFFER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * Lock-free single-producer single-consumer ring of fixed-size slots, used by the demos to hand frames between
+ * threads. Slots are written and read in place: the producer asks for the next free slot, fills it and commits it; the
+ * consumer asks for the oldest committed slot, uses it and releases it. Neither side ever takes a lock or makes a
+ * system call, so a stalled peer can only make the other side see a full or an empty ring.
+ *
+ * Exactly one thread may produce and exactly one thread may consume at any time.
+ */
+typedef struct {
+    uint8_t *slots;
+    size_t slot_size;
+    uint32_t num_slots;
+    uint32_t mask;
+    // Written by the producer only; kept on its own cache line so the two sides do not false-share.
+    uint32_t head __attribute__((aligned(64)));
+    // Written by the consumer only.
+    uint32_t tail __attribute__((aligned(64)));
+} koala_ring_buffer_t;
+
+/**
+ * Allocates a ring of `num_slots` slots, `slot_size` bytes each. `num_slots` must be a power of two.
+ *
+ * @return `false` if `num_slots` is not a power of two or on allocation failure.
+ */
+static inline bool koala_ring_buffer_init(koala_ring_buffer_t *ring, size_t slot_size, uint32_t num_slots) {
+    if ((num_slots == 0) || ((num_slots & (num_slots - 1)) != 0)) {
+        return false;
+    }
+
+    ring->slots = (uint8_t *) calloc(num_slots, slot_size);
+    if (!ring->slots) {
+        return false;
+    }
+    ring->slot_size = slot_size;
+    ring->num_slots = num_slots;
+    ring->mask = num_slots - 1;
+    ring->head = 0;
+    ring->tail = 0;
+
+    return true;
+}
+
+static inline void koala_ring_buffer_free(koala_ring_buffer_t *ring) {
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+/**
+ * Number of committed slots not yet released by the consumer. Exact when called from either side; any other thread
+ * gets a snapshot.
+ */
+static inline uint32_t koala_ring_buffer_size(const koala_ring_buffer_t *ring) {
+    const uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    const uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    return head - tail;
+}
+
+/**
+ * Producer side. Returns the next free slot, or `NULL` if the ring is full.
+ */
+static inline void *koala_ring_buffer_acquire_write(koala_ring_buffer_t *ring) {
+    const uint32_t head = ring->head;
+    const uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if ((head - tail) == ring->num_slots) {
+        return NULL;
+    }
+    return ring->slots + ((size_t) (head & ring->mask) * ring->slot_size);
+}
+
+/**
+ * Producer side. Publishes the slot returned by the last `koala_ring_buffer_acquire_write()` to the consumer.
+ */
+static inline void koala_ring_buffer_commit_write(koala_ring_buffer_t *ring) {
+    __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Consumer side. Returns the oldest committed slot, or `NULL` if the ring is empty.
+ */
+static inline void *koala_ring_buffer_acquire_read(koala_ring_buffer_t *ring) {
+    const uint32_t tail = ring->tail;
+    const uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+        return NULL;
+    }
+    return ring->slots + ((size_t) (tail & ring->mask) * ring->slot_size);
+}
+
+/**
+ * Consumer side. Hands the slot returned by the last `koala_ring_buffer_acquire_read()` back to the producer.
+ */
+static inline void koala_ring_buffer_release_read(koala_ring_buffer_t *ring) {
+    __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+}
+
+#endif // KOALA_RING_BUFFER_H
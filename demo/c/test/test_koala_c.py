@@ -9,13 +9,22 @@
 #    specific language governing permissions and limitations under the License.
 #
 
+import json
+import math
 import os.path
+import shutil
+import struct
 import subprocess
 import sys
+import tempfile
 import unittest
+import wave
 
 
 class KoalaCTestCase(unittest.TestCase):
+    # RMS difference between chunked and sequential output, relative to full scale, with a 1-second warm-up. Dropping a
+    # single frame at one seam of test.wav already costs about 4e-3, and a one-sample shift of one chunk about 1.6e-2.
+    CHUNK_TOLERANCE = 1e-4
 
     @classmethod
     def setUpClass(cls):
@@ -48,6 +57,12 @@ class KoalaCTestCase(unittest.TestCase):
     def _get_audio_file(self, audio_file_name):
         return os.path.join(self._root_dir, 'resources/audio_samples', audio_file_name)
 
+    @staticmethod
+    def _read_wav(path):
+        with wave.open(path, 'rb') as f:
+            buffer = f.readframes(f.getnframes())
+            return struct.unpack('%dh' % f.getnframes(), buffer)
+
     def run_koala(self, audio_file_name):
         args = [
             os.path.join(os.path.dirname(__file__), "../build/koala_demo_file"),
@@ -66,6 +81,254 @@ class KoalaCTestCase(unittest.TestCase):
     def test_koala(self):
         self.run_koala("test.wav")
 
+    def _run_file_demo(self, output_path, *extra_args):
+        args = [
+            os.path.join(os.path.dirname(__file__), "../build/koala_demo_file"),
+            "-a", self._access_key,
+            "-l", self._get_library_file(),
+            "-m", self._get_model_path(),
+            "-i", self._get_audio_file("test.wav"),
+            "-o", output_path
+        ] + list(extra_args)
+        process = subprocess.Popen(args, stderr=subprocess.PIPE, stdout=subprocess.PIPE)
+        stdout, stderr = process.communicate()
+        self.assertEqual(process.poll(), 0)
+        self.assertEqual(stderr.decode('utf-8'), '')
+        self.assertTrue("real time factor" in stdout.decode('utf-8'))
+        return stdout.decode('utf-8')
+
+    def test_koala_mmap(self):
+        if self._platform == "windows":
+            self.skipTest("memory-mapped processing is POSIX-only")
+
+        with tempfile.TemporaryDirectory() as output_dir:
+            stdio_path = os.path.join(output_dir, "stdio.wav")
+            mmap_path = os.path.join(output_dir, "mmap.wav")
+            self._run_file_demo(stdio_path)
+            self._run_file_demo(mmap_path, "-z")
+            self.assertEqual(self._read_wav(mmap_path), self._read_wav(stdio_path))
+
+    def test_koala_pipeline(self):
+        with tempfile.TemporaryDirectory() as output_dir:
+            sequential_path = os.path.join(output_dir, "sequential.wav")
+            pipeline_path = os.path.join(output_dir, "pipeline.wav")
+            self._run_file_demo(sequential_path)
+            stdout = self._run_file_demo(pipeline_path, "-p")
+            self.assertTrue("stage utilization" in stdout)
+            self.assertEqual(self._read_wav(pipeline_path), self._read_wav(sequential_path))
+
+    def test_koala_latency(self):
+        with tempfile.TemporaryDirectory() as output_dir:
+            json_path = os.path.join(output_dir, "latency.json")
+            csv_path = os.path.join(output_dir, "latency.csv")
+            stdout = self._run_file_demo(
+                os.path.join(output_dir, "output.wav"),
+                "-j", json_path,
+                "-c", csv_path)
+            self.assertTrue("p99.9" in stdout)
+
+            with open(json_path, 'r') as f:
+                result = json.load(f)
+            self.assertGreater(result['count'], 0)
+            self.assertEqual(sum(x['count'] for x in result['buckets']), result['count'])
+            keys = ('min_nsec', 'p50_nsec', 'p90_nsec', 'p99_nsec', 'p99_9_nsec', 'max_nsec')
+            percentiles = [result[key] for key in keys]
+            self.assertEqual(percentiles, sorted(percentiles))
+
+            with open(csv_path, 'r') as f:
+                rows = f.read().strip().split('\n')
+            self.assertEqual(len(rows) - 1, len(result['buckets']))
+
+    def test_batch(self):
+        with tempfile.TemporaryDirectory() as input_dir, tempfile.TemporaryDirectory() as output_dir:
+            input_names = ["test_%d.wav" % i for i in range(4)] + ["noise.wav"]
+            for name in input_names:
+                source_name = "noise.wav" if name == "noise.wav" else "test.wav"
+                shutil.copy(self._get_audio_file(source_name), os.path.join(input_dir, name))
+
+            args = [
+                os.path.join(os.path.dirname(__file__), "../build/koala_demo_batch"),
+                "-a", self._access_key,
+                "-l", self._get_library_file(),
+                "-m", self._get_model_path(),
+                "-i", input_dir,
+                "-o", output_dir,
+                "-t", "2"
+            ]
+            process = subprocess.Popen(args, stderr=subprocess.PIPE, stdout=subprocess.PIPE)
+            stdout, stderr = process.communicate()
+            self.assertEqual(process.poll(), 0)
+            self.assertEqual(stderr.decode('utf-8'), '')
+            self.assertTrue("files failed   : 0" in stdout.decode('utf-8'))
+            for name in input_names:
+                self.assertEqual(
+                    os.path.getsize(os.path.join(output_dir, name)),
+                    os.path.getsize(os.path.join(input_dir, name)))
+
+    def test_batch_duplicate_names(self):
+        with tempfile.TemporaryDirectory() as input_dir, tempfile.TemporaryDirectory() as output_dir:
+            manifest_path = os.path.join(input_dir, "manifest.txt")
+            with open(manifest_path, 'w') as f:
+                for name in ("a", "b"):
+                    os.mkdir(os.path.join(input_dir, name))
+                    input_path = os.path.join(input_dir, name, "test.wav")
+                    shutil.copy(self._get_audio_file("test.wav"), input_path)
+                    f.write(input_path + "\n")
+
+            args = [
+                os.path.join(os.path.dirname(__file__), "../build/koala_demo_batch"),
+                "-a", self._access_key,
+                "-l", self._get_library_file(),
+                "-m", self._get_model_path(),
+                "-i", manifest_path,
+                "-o", output_dir,
+                "-t", "2"
+            ]
+            process = subprocess.Popen(args, stderr=subprocess.PIPE, stdout=subprocess.PIPE)
+            process.communicate()
+            self.assertNotEqual(process.poll(), 0)
+            self.assertEqual(os.listdir(output_dir), [])
+
+    def test_batch_chunks(self):
+        with tempfile.TemporaryDirectory() as sequential_dir, tempfile.TemporaryDirectory() as chunked_dir:
+            sequential_path = os.path.join(sequential_dir, "test.wav")
+            args = [
+                os.path.join(os.path.dirname(__file__), "../build/koala_demo_file"),
+                "-a", self._access_key,
+                "-l", self._get_library_file(),
+                "-m", self._get_model_path(),
+                "-i", self._get_audio_file("test.wav"),
+                "-o", sequential_path
+            ]
+            process = subprocess.Popen(args, stderr=subprocess.PIPE, stdout=subprocess.PIPE)
+            process.communicate()
+            self.assertEqual(process.poll(), 0)
+
+            args = [
+                os.path.join(os.path.dirname(__file__), "../build/koala_demo_batch"),
+                "-a", self._access_key,
+                "-l", self._get_library_file(),
+                "-m", self._get_model_path(),
+                "-i", self._get_audio_file("test.wav"),
+                "-o", chunked_dir,
+                "-t", "4",
+                "-c", "1",
+                "-w", "1"
+            ]
+            process = subprocess.Popen(args, stderr=subprocess.PIPE, stdout=subprocess.PIPE)
+            stdout, stderr = process.communicate()
+            self.assertEqual(process.poll(), 0)
+            self.assertEqual(stderr.decode('utf-8'), '')
+
+            sequential_pcm = self._read_wav(sequential_path)
+            chunked_pcm = self._read_wav(os.path.join(chunked_dir, "test.wav"))
+            self.assertEqual(len(chunked_pcm), len(sequential_pcm))
+            self.assertEqual(chunked_pcm[:16000], sequential_pcm[:16000])
+
+            error_energy = sum((x - y) ** 2 for x, y in zip(chunked_pcm, sequential_pcm)) / len(sequential_pcm)
+            self.assertLess(math.sqrt(error_energy) / 32768.0, self.CHUNK_TOLERANCE)
+
+    def test_benchmark_startup(self):
+        with tempfile.TemporaryDirectory() as output_dir:
+            json_path = os.path.join(output_dir, "startup.json")
+            args = [
+                os.path.join(os.path.dirname(__file__), "../build/koala_benchmark_startup"),
+                "-a", self._access_key,
+                "-l", self._get_library_file(),
+                "-m", self._get_model_path(),
+                "-i", self._get_audio_file("test.wav"),
+                "-j", json_path,
+                "-n", "2"
+            ]
+            process = subprocess.Popen(args, stderr=subprocess.PIPE, stdout=subprocess.PIPE)
+            stdout, stderr = process.communicate()
+            self.assertEqual(process.poll(), 0)
+            self.assertEqual(stderr.decode('utf-8'), '')
+            with open(json_path, 'r') as f:
+                result = json.load(f)
+            keys = ('dl_open_usec', 'init_usec', 'first_frame_usec', 'steady_frame_usec', 'time_to_first_frame_usec')
+            for key in keys:
+                self.assertGreaterEqual(result[key], 0)
+            self.assertGreaterEqual(
+                result['time_to_first_frame_usec'],
+                result['dl_open_usec'] + result['init_usec'] + result['first_frame_usec'])
+
+    def test_benchmark_streams(self):
+        with tempfile.TemporaryDirectory() as output_dir:
+            json_path = os.path.join(output_dir, "streams.json")
+            args = [
+                os.path.join(os.path.dirname(__file__), "../build/koala_benchmark_streams"),
+                "-a", self._access_key,
+                "-l", self._get_library_file(),
+                "-m", self._get_model_path(),
+                "-i", self._get_audio_file("test.wav"),
+                "-x", "2",
+                "-d", "1",
+                "-j", json_path
+            ]
+            process = subprocess.Popen(args, stderr=subprocess.PIPE, stdout=subprocess.PIPE)
+            stdout, stderr = process.communicate()
+            self.assertEqual(process.poll(), 0)
+            self.assertEqual(stderr.decode('utf-8'), '')
+            self.assertTrue("max sustainable streams" in stdout.decode('utf-8'))
+
+            with open(json_path, 'r') as f:
+                result = json.load(f)
+            self.assertGreater(len(result['levels']), 0)
+            self.assertLessEqual(result['max_sustainable_streams'], 2)
+            self.assertEqual(result['ceiling_reached'], result['max_sustainable_streams'] == 2)
+            for level in result['levels']:
+                self.assertEqual(len(level['stream_miss_rates']), level['num_streams'])
+                self.assertGreater(level['num_frames'], 0)
+
+    def test_benchmark_throughput(self):
+        with tempfile.TemporaryDirectory() as output_dir:
+            json_path = os.path.join(output_dir, "throughput.json")
+            args = [
+                os.path.join(os.path.dirname(__file__), "../build/koala_benchmark_throughput"),
+                "-a", self._access_key,
+                "-l", self._get_library_file(),
+                "-m", self._get_model_path(),
+                "-i", self._get_audio_file("test.wav"),
+                "-I", "1,2",
+                "-T", "1,2",
+                "-F", "1,4",
+                "-d", "0.5",
+                "-j", json_path
+            ]
+            process = subprocess.Popen(args, stderr=subprocess.PIPE, stdout=subprocess.PIPE)
+            stdout, stderr = process.communicate()
+            self.assertEqual(process.poll(), 0)
+            self.assertEqual(stderr.decode('utf-8'), '')
+            self.assertTrue("frames/sec" in stdout.decode('utf-8'))
+
+            with open(json_path, 'r') as f:
+                result = json.load(f)
+            configs = [(x['num_instances'], x['num_threads'], x['frames_per_call']) for x in result['results']]
+            self.assertEqual(configs, [(1, 1, 1), (1, 1, 4), (2, 1, 1), (2, 1, 4), (2, 2, 1), (2, 2, 4)])
+            for x in result['results']:
+                self.assertGreater(x['num_frames'], 0)
+                self.assertGreater(x['frames_per_sec'], 0)
+                machine_state = x['machine_state']
+                self.assertIn(machine_state['throttled'], (True, False))
+                self.assertLessEqual(machine_state['before']['elapsed_sec'], machine_state['after']['elapsed_sec'])
+
+    def test_threads(self):
+        args = [
+            os.path.join(os.path.dirname(__file__), "../build/test_koala_threads"),
+            "-a", self._access_key,
+            "-l", self._get_library_file(),
+            "-m", self._get_model_path(),
+            "-i", self._get_audio_file("test.wav"),
+            "-t", "8",
+            "-n", "32"
+        ]
+        process = subprocess.Popen(args, stderr=subprocess.PIPE, stdout=subprocess.PIPE)
+        stdout, stderr = process.communicate()
+        self.assertEqual(process.poll(), 0)
+        self.assertEqual(stderr.decode('utf-8'), '')
+        self.assertTrue("failures: 0" in stdout.decode('utf-8'))
+
 
 if __name__ == '__main__':
     if len(sys.argv) < 3 or len(sys.argv) > 4:
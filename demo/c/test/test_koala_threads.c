@@ -0,0 +1,478 @@
+/*
+    Copyright 2023 Picovoice Inc.
+
+    You may not use this file except in compliance with the license. A copy of the license is located in the "LICENSE"
+    file accompanying this source.
+
+    Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+    an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the
+    specific language governing permissions and limitations under the License.
+*/
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+
+#include <windows.h>
+
+#else
+
+#include <dlfcn.h>
+
+#endif
+
+#define DR_WAV_IMPLEMENTATION
+
+#include "dr_wav.h"
+
+#include "pv_koala.h"
+
+static void *open_dl(const char *dl_path) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    return LoadLibrary(dl_path);
+
+#else
+
+    return dlopen(dl_path, RTLD_NOW);
+
+#endif
+}
+
+static void *load_symbol(void *handle, const char *symbol) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    return GetProcAddress((HMODULE) handle, symbol);
+
+#else
+
+    return dlsym(handle, symbol);
+
+#endif
+}
+
+static void close_dl(void *handle) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    FreeLibrary((HMODULE) handle);
+
+#else
+
+    dlclose(handle);
+
+#endif
+}
+
+static void print_dl_error(const char *message) {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+    fprintf(stderr, "%s with code '%lu'.\n", message, GetLastError());
+
+#else
+
+    fprintf(stderr, "%s with '%s'.\n", message, dlerror());
+
+#endif
+}
+
+static const char *(*pv_status_to_string_func)(pv_status_t) = NULL;
+static int32_t (*pv_sample_rate_func)() = NULL;
+static pv_status_t (*pv_koala_init_func)(const char *, const char *, pv_koala_t **) = NULL;
+static void (*pv_koala_delete_func)(pv_koala_t *) = NULL;
+static pv_status_t (*pv_koala_process_func)(pv_koala_t *, const int16_t *, int16_t *) = NULL;
+static pv_status_t (*pv_koala_reset_func)(pv_koala_t *) = NULL;
+static pv_status_t (*pv_koala_delay_sample_func)(const pv_koala_t *, int32_t *) = NULL;
+static int32_t (*pv_koala_frame_length_func)() = NULL;
+static const char *(*pv_koala_version_func)() = NULL;
+
+static struct option long_options[] = {
+        {"access_key",     required_argument, NULL, 'a'},
+        {"library_path",   required_argument, NULL, 'l'},
+        {"model_path",     required_argument, NULL, 'm'},
+        {"input_path",     required_argument, NULL, 'i'},
+        {"num_threads",    required_argument, NULL, 't'},
+        {"num_instances",  required_argument, NULL, 'n'},
+        {"num_iterations", required_argument, NULL, 'r'},
+        {NULL,             0,                 NULL, 0},
+};
+
+void print_usage(const char *program_name) {
+    fprintf(stdout,
+            "Usage: %s [-l LIBRARY_PATH -m MODEL_PATH -a ACCESS_KEY -i INPUT_PATH -t NUM_THREADS -n NUM_INSTANCES "
+            "-r NUM_ITERATIONS]\n",
+            program_name);
+}
+
+/**
+ * Work shared by all test threads. Instance `i` is owned by thread `i % num_threads`, and only its owner calls
+ * functions that take it, as the contract in `pv_koala.h` requires. The instance-free getters are called from every
+ * thread while the others are processing.
+ */
+typedef struct {
+    const char *access_key;
+    const char *model_path;
+    const int16_t *pcm;
+    int32_t num_frames;
+    int32_t num_threads;
+    int32_t num_instances;
+    int32_t num_iterations;
+    int32_t expected_delay_sample;
+    uint64_t expected_checksum;
+    pv_koala_t **koalas;
+} shared_state_t;
+
+typedef struct {
+    shared_state_t *shared;
+    int32_t thread_index;
+    int32_t num_failures;
+} thread_state_t;
+
+static uint64_t fnv1a_update(uint64_t hash, const int16_t *pcm, int32_t num_samples) {
+    const uint8_t *bytes = (const uint8_t *) pcm;
+    for (int32_t i = 0; i < num_samples * (int32_t) sizeof(int16_t); i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void *init_thread(void *arg) {
+    thread_state_t *state = (thread_state_t *) arg;
+    shared_state_t *shared = state->shared;
+
+    for (int32_t i = state->thread_index; i < shared->num_instances; i += shared->num_threads) {
+        pv_status_t status = pv_koala_init_func(shared->access_key, shared->model_path, &shared->koalas[i]);
+        if (status != PV_STATUS_SUCCESS) {
+            fprintf(stderr, "instance %d: 'pv_koala_init' failed with '%s'.\n", i, pv_status_to_string_func(status));
+            shared->koalas[i] = NULL;
+            state->num_failures++;
+        }
+    }
+
+    return NULL;
+}
+
+static void *process_thread(void *arg) {
+    thread_state_t *state = (thread_state_t *) arg;
+    shared_state_t *shared = state->shared;
+    const int32_t frame_length = pv_koala_frame_length_func();
+
+    int16_t *enhanced_pcm = (int16_t *) malloc(frame_length * sizeof(int16_t));
+    uint64_t *checksums = (uint64_t *) malloc(shared->num_instances * sizeof(uint64_t));
+    if (!enhanced_pcm || !checksums) {
+        fprintf(stderr, "failed to allocate memory for thread %d.\n", state->thread_index);
+        free(enhanced_pcm);
+        free(checksums);
+        state->num_failures++;
+        return NULL;
+    }
+
+    for (int32_t iteration = 0; iteration < shared->num_iterations; iteration++) {
+        for (int32_t i = state->thread_index; i < shared->num_instances; i += shared->num_threads) {
+            checksums[i] = 14695981039346656037ULL;
+            if (iteration > 0 && pv_koala_reset_func(shared->koalas[i]) != PV_STATUS_SUCCESS) {
+                fprintf(stderr, "instance %d: 'pv_koala_reset' failed.\n", i);
+                state->num_failures++;
+            }
+        }
+
+        // Frames of the owned instances are interleaved so that consecutive calls on this thread alternate instances.
+        for (int32_t j = 0; j < shared->num_frames; j++) {
+            for (int32_t i = state->thread_index; i < shared->num_instances; i += shared->num_threads) {
+                pv_status_t status = pv_koala_process_func(
+                        shared->koalas[i],
+                        &shared->pcm[j * frame_length],
+                        enhanced_pcm);
+                if (status != PV_STATUS_SUCCESS) {
+                    fprintf(stderr,
+                            "instance %d: 'pv_koala_process' failed with '%s'.\n",
+                            i,
+                            pv_status_to_string_func(status));
+                    state->num_failures++;
+                    continue;
+                }
+                checksums[i] = fnv1a_update(checksums[i], enhanced_pcm, frame_length);
+
+                int32_t delay_sample = 0;
+                status = pv_koala_delay_sample_func(shared->koalas[i], &delay_sample);
+                if ((status != PV_STATUS_SUCCESS) || (delay_sample != shared->expected_delay_sample)) {
+                    fprintf(stderr, "instance %d: 'pv_koala_delay_sample' returned an unexpected value.\n", i);
+                    state->num_failures++;
+                }
+
+                if ((pv_koala_frame_length_func() != frame_length) || !pv_koala_version_func()) {
+                    fprintf(stderr, "reentrant getters returned unexpected values.\n");
+                    state->num_failures++;
+                }
+            }
+        }
+
+        for (int32_t i = state->thread_index; i < shared->num_instances; i += shared->num_threads) {
+            if (checksums[i] != shared->expected_checksum) {
+                fprintf(stderr, "instance %d: output differs from the single-threaded reference.\n", i);
+                state->num_failures++;
+            }
+        }
+    }
+
+    free(enhanced_pcm);
+    free(checksums);
+
+    return NULL;
+}
+
+static void *delete_thread(void *arg) {
+    thread_state_t *state = (thread_state_t *) arg;
+    shared_state_t *shared = state->shared;
+
+    for (int32_t i = state->thread_index; i < shared->num_instances; i += shared->num_threads) {
+        if (shared->koalas[i]) {
+            pv_koala_delete_func(shared->koalas[i]);
+            shared->koalas[i] = NULL;
+        }
+    }
+
+    return NULL;
+}
+
+static int32_t run_threads(void *(*func)(void *), thread_state_t *states, int32_t num_threads) {
+    pthread_t *threads = (pthread_t *) malloc(num_threads * sizeof(pthread_t));
+    if (!threads) {
+        fprintf(stderr, "failed to allocate memory for threads.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int32_t i = 0; i < num_threads; i++) {
+        states[i].num_failures = 0;
+        if (pthread_create(&threads[i], NULL, func, &states[i]) != 0) {
+            fprintf(stderr, "failed to create thread %d.\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    int32_t num_failures = 0;
+    for (int32_t i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+        num_failures += states[i].num_failures;
+    }
+
+    free(threads);
+
+    return num_failures;
+}
+
+int picovoice_main(int argc, char *argv[]) {
+    const char *library_path = NULL;
+    const char *model_path = NULL;
+    const char *access_key = NULL;
+    const char *input_path = NULL;
+    int32_t num_threads = 8;
+    int32_t num_instances = 32;
+    int32_t num_iterations = 2;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "l:m:a:i:t:n:r:", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'l':
+                library_path = optarg;
+                break;
+            case 'm':
+                model_path = optarg;
+                break;
+            case 'a':
+                access_key = optarg;
+                break;
+            case 'i':
+                input_path = optarg;
+                break;
+            case 't':
+                num_threads = (int32_t) strtol(optarg, NULL, 10);
+                break;
+            case 'n':
+                num_instances = (int32_t) strtol(optarg, NULL, 10);
+                break;
+            case 'r':
+                num_iterations = (int32_t) strtol(optarg, NULL, 10);
+                break;
+            default:
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    if (!library_path || !access_key || !input_path || (num_threads < 1) || (num_instances < num_threads) ||
+        (num_iterations < 1)) {
+        print_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    void *koala_library = open_dl(library_path);
+    if (!koala_library) {
+        fprintf(stderr, "failed to open library at '%s'.\n", library_path);
+        exit(EXIT_FAILURE);
+    }
+
+    pv_status_to_string_func = load_symbol(koala_library, "pv_status_to_string");
+    if (!pv_status_to_string_func) {
+        print_dl_error("failed to load 'pv_status_to_string'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_sample_rate_func = load_symbol(koala_library, "pv_sample_rate");
+    if (!pv_sample_rate_func) {
+        print_dl_error("failed to load 'pv_sample_rate'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_init_func = load_symbol(koala_library, "pv_koala_init");
+    if (!pv_koala_init_func) {
+        print_dl_error("failed to load 'pv_koala_init'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_delete_func = load_symbol(koala_library, "pv_koala_delete");
+    if (!pv_koala_delete_func) {
+        print_dl_error("failed to load 'pv_koala_delete'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_process_func = load_symbol(koala_library, "pv_koala_process");
+    if (!pv_koala_process_func) {
+        print_dl_error("failed to load 'pv_koala_process'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_reset_func = load_symbol(koala_library, "pv_koala_reset");
+    if (!pv_koala_reset_func) {
+        print_dl_error("failed to load 'pv_koala_reset'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_delay_sample_func = load_symbol(koala_library, "pv_koala_delay_sample");
+    if (!pv_koala_delay_sample_func) {
+        print_dl_error("failed to load 'pv_koala_delay_sample'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_frame_length_func = load_symbol(koala_library, "pv_koala_frame_length");
+    if (!pv_koala_frame_length_func) {
+        print_dl_error("failed to load 'pv_koala_frame_length'");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_version_func = load_symbol(koala_library, "pv_koala_version");
+    if (!pv_koala_version_func) {
+        print_dl_error("failed to load 'pv_koala_version'");
+        exit(EXIT_FAILURE);
+    }
+
+    drwav input_file;
+    if (!drwav_init_file(&input_file, input_path, NULL)) {
+        fprintf(stderr, "failed to open wav file at '%s'.\n", input_path);
+        exit(EXIT_FAILURE);
+    }
+
+    if ((input_file.sampleRate != (uint32_t) pv_sample_rate_func()) || (input_file.bitsPerSample != 16) ||
+        (input_file.channels != 1)) {
+        fprintf(stderr, "audio should be single-channel 16-bit PCM sampled at %d Hz.\n", pv_sample_rate_func());
+        exit(EXIT_FAILURE);
+    }
+
+    const int32_t frame_length = pv_koala_frame_length_func();
+    const int32_t num_frames = (int32_t) (input_file.totalPCMFrameCount / frame_length);
+    int16_t *pcm = (int16_t *) malloc(num_frames * frame_length * sizeof(int16_t));
+    if (!pcm) {
+        fprintf(stderr, "failed to allocate pcm memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (drwav_read_pcm_frames_s16(&input_file, num_frames * frame_length, pcm) != (drwav_uint64) num_frames * frame_length) {
+        fprintf(stderr, "failed to read from '%s'.\n", input_path);
+        exit(EXIT_FAILURE);
+    }
+    drwav_uninit(&input_file);
+
+    int16_t *enhanced_pcm = (int16_t *) malloc(frame_length * sizeof(int16_t));
+    if (!enhanced_pcm) {
+        fprintf(stderr, "failed to allocate enhanced_pcm memory.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    pv_koala_t *reference_koala = NULL;
+    pv_status_t koala_status = pv_koala_init_func(access_key, model_path, &reference_koala);
+    if (koala_status != PV_STATUS_SUCCESS) {
+        fprintf(stderr, "failed to init with '%s'.\n", pv_status_to_string_func(koala_status));
+        exit(EXIT_FAILURE);
+    }
+    fprintf(stdout, "V%s\n\n", pv_koala_version_func());
+
+    int32_t expected_delay_sample = 0;
+    koala_status = pv_koala_delay_sample_func(reference_koala, &expected_delay_sample);
+    if (koala_status != PV_STATUS_SUCCESS) {
+        fprintf(stderr, "failed to get delay sample with '%s'.\n", pv_status_to_string_func(koala_status));
+        exit(EXIT_FAILURE);
+    }
+
+    uint64_t expected_checksum = 14695981039346656037ULL;
+    for (int32_t j = 0; j < num_frames; j++) {
+        koala_status = pv_koala_process_func(reference_koala, &pcm[j * frame_length], enhanced_pcm);
+        if (koala_status != PV_STATUS_SUCCESS) {
+            fprintf(stderr, "'pv_koala_process' failed with '%s'.\n", pv_status_to_string_func(koala_status));
+            exit(EXIT_FAILURE);
+        }
+        expected_checksum = fnv1a_update(expected_checksum, enhanced_pcm, frame_length);
+    }
+    pv_koala_delete_func(reference_koala);
+    free(enhanced_pcm);
+
+    pv_koala_t **koalas = (pv_koala_t **) calloc(num_instances, sizeof(pv_koala_t *));
+    thread_state_t *states = (thread_state_t *) calloc(num_threads, sizeof(thread_state_t));
+    if (!koalas || !states) {
+        fprintf(stderr, "failed to allocate memory for instances.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    shared_state_t shared = {
+            .access_key = access_key,
+            .model_path = model_path,
+            .pcm = pcm,
+            .num_frames = num_frames,
+            .num_threads = num_threads,
+            .num_instances = num_instances,
+            .num_iterations = num_iterations,
+            .expected_delay_sample = expected_delay_sample,
+            .expected_checksum = expected_checksum,
+            .koalas = koalas,
+    };
+    for (int32_t i = 0; i < num_threads; i++) {
+        states[i].shared = &shared;
+        states[i].thread_index = i;
+    }
+
+    fprintf(stdout, "threads: %d, instances: %d, frames: %d, iterations: %d\n",
+            num_threads, num_instances, num_frames, num_iterations);
+
+    int32_t num_failures = run_threads(init_thread, states, num_threads);
+    if (num_failures == 0) {
+        num_failures += run_threads(process_thread, states, num_threads);
+    }
+    num_failures += run_threads(delete_thread, states, num_threads);
+
+    fprintf(stdout, "failures: %d\n", num_failures);
+
+    free(states);
+    free(koalas);
+    free(pcm);
+    close_dl(koala_library);
+
+    return (num_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char *argv[]) {
+    return picovoice_main(argc, argv);
+}
@@ -10,12 +10,117 @@
 #
 
 import argparse
+import array
+import mmap
+import os
 import struct
+import sys
 import wave
 
-from pvkoala import create, KoalaActivationLimitError
+from pvkoala import create, KoalaActivationLimitError, KoalaStream
 
 PROGRESS_BAR_LENGTH = 30
+CHUNK_LENGTH = 16384
+WAV_HEADER_LENGTH = 44
+
+
+def find_data_chunk(wav_file):
+    wav_file.seek(12)
+    while True:
+        chunk_header = wav_file.read(8)
+        if len(chunk_header) < 8:
+            raise ValueError('WAV file has no data chunk')
+        chunk_id, chunk_size = struct.unpack('<4sI', chunk_header)
+        if chunk_id == b'data':
+            return wav_file.tell(), chunk_size
+        wav_file.seek(chunk_size + (chunk_size & 1), os.SEEK_CUR)
+
+
+# Enhances the whole recording with `koala.process_buffer()` on memory-mapped files. It still makes one ctypes call per
+# frame from Python, but the engine reads and writes every frame in place, so no sample is copied into Python objects.
+# WAV samples are little-endian, so this only applies on little-endian hosts.
+def enhance_mapped(koala, input_path, output_path):
+    with open(input_path, 'rb') as input_file:
+        data_offset, data_size = find_data_chunk(input_file)
+        num_samples = min(data_size, os.fstat(input_file.fileno()).st_size - data_offset) // 2
+
+        with open(output_path, 'w+b') as output_file:
+            output_file.write(struct.pack(
+                '<4sI4s4sIHHIIHH4sI',
+                b'RIFF',
+                WAV_HEADER_LENGTH - 8 + num_samples * 2,
+                b'WAVE',
+                b'fmt ',
+                16,
+                1,
+                1,
+                koala.sample_rate,
+                koala.sample_rate * 2,
+                2,
+                16,
+                b'data',
+                num_samples * 2))
+            output_file.truncate(WAV_HEADER_LENGTH + num_samples * 2)
+            if num_samples == 0:
+                return 0
+
+            # A copy-on-write mapping of the input is writable, which lets the engine read it without a copy.
+            with mmap.mmap(input_file.fileno(), 0, access=mmap.ACCESS_COPY) as input_map, \
+                    mmap.mmap(output_file.fileno(), 0, access=mmap.ACCESS_WRITE) as output_map:
+                input_pcm = memoryview(input_map)[data_offset:data_offset + num_samples * 2].cast('h')
+                output_pcm = memoryview(output_map)[WAV_HEADER_LENGTH:].cast('h')
+                try:
+                    koala.process_buffer(input_pcm, output_pcm)
+                finally:
+                    input_pcm.release()
+                    output_pcm.release()
+                output_map.flush()
+
+    return num_samples
+
+
+def write_chunk(output_file, chunk):
+    if sys.byteorder == 'big':
+        chunk.byteswap()
+    output_file.writeframes(chunk.tobytes())
+    return len(chunk)
+
+
+def enhance_streamed(koala, input_path, output_path):
+    num_samples_written = 0
+    with wave.open(input_path, 'rb') as input_file, wave.open(output_path, 'wb') as output_file:
+        output_file.setnchannels(1)
+        output_file.setsampwidth(2)
+        output_file.setframerate(koala.sample_rate)
+
+        input_length = input_file.getnframes()
+        stream = KoalaStream(koala)
+        num_samples_read = 0
+        while num_samples_read < input_length:
+            input_chunk = array.array('h')
+            input_chunk.frombytes(input_file.readframes(CHUNK_LENGTH))
+            if len(input_chunk) == 0:
+                break
+            num_samples_read += len(input_chunk)
+
+            if sys.byteorder == 'big':
+                input_chunk.byteswap()
+            num_samples_written += write_chunk(output_file, stream.process(input_chunk))
+
+            progress = num_samples_read / input_length
+            bar_length = int(progress * PROGRESS_BAR_LENGTH)
+            print(
+                '\r[%3d%%]|%s%s|' % (
+                    progress * 100,
+                    '#' * bar_length,
+                    ' ' * (PROGRESS_BAR_LENGTH - bar_length)),
+                end='',
+                flush=True)
+
+        num_samples_written += write_chunk(output_file, stream.close())
+        print()
+
+    return num_samples_written
 
 
 def main():
@@ -38,6 +143,10 @@ def main():
     parser.add_argument(
         '--model_path',
         help='Absolute path to Koala model. Default: using the model provided by `pvkoala`')
+    parser.add_argument(
+        '--streaming',
+        action='store_true',
+        help='Process the audio chunk by chunk with a progress bar, instead of memory-mapping both files')
     args = parser.parse_args()
 
     if not args.input_path.lower().endswith('.wav'):
@@ -67,45 +176,12 @@ def main():
                 raise ValueError('This demo can only process single-channel WAV files')
             if input_file.getsampwidth() != 2:
                 raise ValueError('This demo can only process WAV files with 16-bit PCM encoding')
-            input_length = input_file.getnframes()
-
-            with wave.open(args.output_path, 'wb') as output_file:
-                output_file.setnchannels(1)
-                output_file.setsampwidth(2)
-                output_file.setframerate(koala.sample_rate)
-
-                start_sample = 0
-                while start_sample < input_length + koala.delay_sample:
-                    end_sample = start_sample + koala.frame_length
-
-                    frame_buffer = input_file.readframes(koala.frame_length)
-                    num_samples_read = len(frame_buffer) // struct.calcsize('h')
-                    input_frame = struct.unpack('%dh' % num_samples_read, frame_buffer)
-                    if num_samples_read < koala.frame_length:
-                        input_frame = input_frame + (0,) * (koala.frame_length - num_samples_read)
-
-                    output_frame = koala.process(input_frame)
-
-                    if end_sample > koala.delay_sample:
-                        if end_sample > input_length + koala.delay_sample:
-                            output_frame = output_frame[:input_length + koala.delay_sample - start_sample]
-                        if start_sample < koala.delay_sample:
-                            output_frame = output_frame[koala.delay_sample - start_sample:]
-                        output_file.writeframes(struct.pack('%dh' % len(output_frame), *output_frame))
-                        length_sec += len(output_frame) / koala.sample_rate
-
-                    start_sample = end_sample
-                    progress = start_sample / (input_length + koala.delay_sample)
-                    bar_length = int(progress * PROGRESS_BAR_LENGTH)
-                    print(
-                        '\r[%3d%%]|%s%s|' % (
-                            progress * 100,
-                            '#' * bar_length,
-                            ' ' * (PROGRESS_BAR_LENGTH - bar_length)),
-                        end='',
-                        flush=True)
-
-                print()
+
+        if sys.byteorder == 'little' and not args.streaming:
+            num_samples = enhance_mapped(koala, args.input_path, args.output_path)
+        else:
+            num_samples = enhance_streamed(koala, args.input_path, args.output_path)
+        length_sec = num_samples / koala.sample_rate
 
     except KeyboardInterrupt:
         print()
@@ -31,6 +31,12 @@ extern "C" {
  * The length of the delay in samples can be obtained from `pv_koala_delay_sample()`. The number of samples per frame
  * can be attained by calling `pv_koala_frame_length()`. The incoming audio needs to have a sample rate equal to
  * `pv_sample_rate()` and be 16-bit linearly-encoded. Koala operates on single-channel audio.
+ *
+ * Thread safety: distinct instances may be used from different threads at the same time, and `pv_koala_init` may
+ * run in parallel on several threads, each constructing its own instance. Every call that takes an instance,
+ * `pv_koala_delay_sample` included, must be serialized by the caller with all other calls on that instance.
+ * `pv_sample_rate`, `pv_koala_frame_length` and `pv_koala_version` take no instance and are reentrant.
+ * `test_koala_threads` in the C demos exercises this contract.
  */
 typedef struct pv_koala pv_koala_t;
 
@@ -5,3 +5,9 @@ echo -e "CPU Usage:\t"`cat /proc/stat | awk '/cpu/{printf("%.2f%%\n"), ($2+$4)*1
 echo -e "Memory Usage:\t"`free | awk '/Mem/{printf("%.2f%%"), $3/$2*100}'`
 echo -e "Swap Usage:\t"`free | awk '/Swap/{printf("%.2f%%"), $3/$2*100}'`
 paste <(cat /sys/class/thermal/thermal_zone*/type) <(cat /sys/class/thermal/thermal_zone*/temp) | column -s $'\t' -t | sed 's/\(.\)..$/.\1°C/'
+if [ -f /sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq ]; then
+    echo -e "CPU Frequency:\t"`cat /sys/devices/system/cpu/cpu*/cpufreq/scaling_cur_freq | awk '{printf("%d MHz "), $1/1000}'`
+fi
+if command -v vcgencmd > /dev/null; then
+    echo -e "Throttled:\t"`vcgencmd get_throttled | cut -d= -f2`
+fi